@@ -0,0 +1,21 @@
+#pragma once
+// affine transform, a row vector MLMatrix4 whose last column is (0, 0, 0, 1), stored as
+// the 3x4 column vector matrix: row j is column j of the MLMatrix4, component j of a
+// transformed point is the dot of m[j] and (x, y, z, 1)
+class alignas(16) MLAffine3x4 {
+public:
+	float m[3][4];
+	MLAffine3x4() {};
+	// arguments are the rows of m
+	constexpr MLAffine3x4(
+		float m00, float m01, float m02, float m03,
+		float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23
+	) : m{
+		{ m00, m01, m02, m03 },
+		{ m10, m11, m12, m13 },
+		{ m20, m21, m22, m23 } } {}
+	// binary operators
+	// this followed by rhs, same order as the matrices, 36 multiplies instead of 64
+	MLAffine3x4 operator * (const MLAffine3x4 &rhs) const;
+};
\ No newline at end of file
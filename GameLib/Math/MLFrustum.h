@@ -0,0 +1,13 @@
+#pragma once
+#include "MLPlane.h"
+
+// result of testing a bound against a frustum
+const int ML_OUTSIDE = 0;
+const int ML_INTERSECT = 1;
+const int ML_INSIDE = 2;
+
+class MLFrustum {
+public:
+	// left, right, bottom, top, near and far, unit normals pointing inside
+	MLPlane planes[6];
+};
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "MLHierarchy.h"
+#include <assert.h>
+
+MLHierarchy::MLHierarchy() : _firstdirty(0) {
+}
+
+int MLHierarchy::AddNode(int parent, const MLMatrix4 &local) {
+	int node = GetCount();
+	assert(parent >= -1 && parent < node);
+	_local.push_back(local);
+	_world.push_back(local);
+	_parent.push_back(parent);
+	// _firstdirty is at most the old count, so the new node is already in range
+	_dirty.push_back(1);
+	return node;
+}
+
+void MLHierarchy::Clear() {
+	_local.clear();
+	_world.clear();
+	_parent.clear();
+	_dirty.clear();
+	_firstdirty = 0;
+}
+
+void MLHierarchy::SetLocal(int node, const MLMatrix4 &local) {
+	_local[node] = local;
+	_dirty[node] = 1;
+	if (node < _firstdirty)
+		_firstdirty = node;
+}
+
+void MLHierarchy::Update() {
+	int count = GetCount();
+	// a child is after its parent, so the parent's flag is final when the child is reached
+	for (int i = _firstdirty; i < count; i++) {
+		int parent = _parent[i];
+		if (parent >= 0 && _dirty[parent])
+			_dirty[i] = 1;
+		if (!_dirty[i])
+			continue;
+		_world[i] = parent >= 0 ? _local[i] * _world[parent] : _local[i];
+	}
+	for (int i = _firstdirty; i < count; i++)
+		_dirty[i] = 0;
+	_firstdirty = count;
+}
\ No newline at end of file
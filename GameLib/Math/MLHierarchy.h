@@ -0,0 +1,40 @@
+#pragma once
+#include "MLMatrix.h"
+#include <vector>
+
+/****************************************************
+* Transform hierarchy with lazily updated world matrices.
+* Nodes live in contiguous arrays in parent before child order,
+* so one forward pass updates every changed subtree. Nodes whose
+* local transform and ancestors did not change are not visited.
+*/
+
+class MLHierarchy {
+public:
+	MLHierarchy();
+	// add a node under parent, -1 for a root, and return its index
+	// parent must already exist, which keeps every parent before its children
+	int AddNode(int parent, const MLMatrix4 &local);
+	// remove every node
+	void Clear();
+	int GetCount() const { return (int)_parent.size(); }
+	int GetParent(int node) const { return _parent[node]; }
+
+	// transform relative to the parent, marks node and its subtree dirty
+	void SetLocal(int node, const MLMatrix4 &local);
+	const MLMatrix4 &GetLocal(int node) const { return _local[node]; }
+	// local * parent world, current after Update
+	const MLMatrix4 &GetWorld(int node) const { return _world[node]; }
+
+	// recompute world matrices of dirty nodes and their descendants
+	void Update();
+
+private:
+	std::vector<MLMatrix4> _local;
+	std::vector<MLMatrix4> _world;
+	std::vector<int> _parent;
+	// local changed, or during Update, world recomputed this pass
+	std::vector<unsigned char> _dirty;
+	// lowest dirty index, GetCount() when clean, nothing before it needs a visit
+	int _firstdirty;
+};
\ No newline at end of file
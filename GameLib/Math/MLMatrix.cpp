@@ -1,39 +1,113 @@
 #include "MLUtility.h"
 
-MLMatrix4::MLMatrix4(float _11, float _12, float _13, float _14,
-	float _21, float _22, float _23, float _24,
-	float _31, float _32, float _33, float _34,
-	float _41, float _42, float _43, float _44) {
-
-	this->m[0][0] = _11;
-	this->m[0][1] = _12;
-	this->m[0][2] = _13;
-	this->m[0][3] = _14;
-
-	this->m[1][0] = _21;
-	this->m[1][1] = _22;
-	this->m[1][2] = _23;
-	this->m[1][3] = _24;
-
-	this->m[2][0] = _31;
-	this->m[2][1] = _32;
-	this->m[2][2] = _33;
-	this->m[2][3] = _34;
+// row i of the result is row i of this transforming rhs: sum of m[i][k] * rhs row k
+// loads are unaligned ones, heap blocks on 32 bit targets are only 8 byte aligned
+MLMatrix4 MLMatrix4::operator * (const MLMatrix4& rhs) const {
+	MLMatrix4 res;
+#if defined(ML_SIMD_AVX)
+	// two rows per iteration, one in each 128 bit lane
+	__m256 r0 = _mm256_broadcast_ps((const __m128 *)rhs.m[0]);
+	__m256 r1 = _mm256_broadcast_ps((const __m128 *)rhs.m[1]);
+	__m256 r2 = _mm256_broadcast_ps((const __m128 *)rhs.m[2]);
+	__m256 r3 = _mm256_broadcast_ps((const __m128 *)rhs.m[3]);
+	for (int i = 0; i < 4; i += 2) {
+		__m256 a = _mm256_loadu_ps(this->m[i]);
+		__m256 row = _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x00), r0);
+		row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0x55), r1));
+		row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xaa), r2));
+		row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_shuffle_ps(a, a, 0xff), r3));
+		_mm256_storeu_ps(res.m[i], row);
+	}
+#elif defined(ML_SIMD_SSE2)
+	__m128 r0 = _mm_loadu_ps(rhs.m[0]);
+	__m128 r1 = _mm_loadu_ps(rhs.m[1]);
+	__m128 r2 = _mm_loadu_ps(rhs.m[2]);
+	__m128 r3 = _mm_loadu_ps(rhs.m[3]);
+	for (int i = 0; i < 4; i++) {
+		__m128 a = _mm_loadu_ps(this->m[i]);
+		__m128 row = _mm_mul_ps(_mm_shuffle_ps(a, a, 0x00), r0);
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(a, a, 0x55), r1));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xaa), r2));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xff), r3));
+		_mm_storeu_ps(res.m[i], row);
+	}
+#else
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			res.m[i][j] = this->m[i][0] * rhs.m[0][j] + this->m[i][1] * rhs.m[1][j] +
+				this->m[i][2] * rhs.m[2][j] + this->m[i][3] * rhs.m[3][j];
+		}
+	}
+#endif
+	return res;
+}
 
-	this->m[3][0] = _41;
-	this->m[3][1] = _42;
-	this->m[3][2] = _43;
-	this->m[3][3] = _44;
+// row j of the result is the rows of this weighted by column j of rhs, plus its translation
+MLAffine3x4 MLAffine3x4::operator * (const MLAffine3x4 &rhs) const {
+	MLAffine3x4 res;
+#if defined(ML_SIMD_SSE2)
+	__m128 a0 = _mm_loadu_ps(this->m[0]);
+	__m128 a1 = _mm_loadu_ps(this->m[1]);
+	__m128 a2 = _mm_loadu_ps(this->m[2]);
+	int j = 0;
+#if defined(ML_SIMD_AVX)
+	// rows 0 and 1 together, one in each 128 bit lane
+	__m256 b2 = _mm256_loadu_ps(rhs.m[0]);
+	__m256 row2 = _mm256_mul_ps(_mm256_shuffle_ps(b2, b2, 0x00), _mm256_set_m128(a0, a0));
+	row2 = _mm256_add_ps(row2, _mm256_mul_ps(_mm256_shuffle_ps(b2, b2, 0x55),
+		_mm256_set_m128(a1, a1)));
+	row2 = _mm256_add_ps(row2, _mm256_mul_ps(_mm256_shuffle_ps(b2, b2, 0xaa),
+		_mm256_set_m128(a2, a2)));
+	row2 = _mm256_add_ps(row2, _mm256_and_ps(b2,
+		_mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1))));
+	_mm256_storeu_ps(res.m[0], row2);
+	j = 2;
+#endif
+	for (; j < 3; j++) {
+		__m128 b = _mm_loadu_ps(rhs.m[j]);
+		__m128 row = _mm_mul_ps(_mm_shuffle_ps(b, b, 0x00), a0);
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(b, b, 0x55), a1));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_shuffle_ps(b, b, 0xaa), a2));
+		// (0, 0, 0, translation)
+		row = _mm_add_ps(row, _mm_and_ps(b, _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1))));
+		_mm_storeu_ps(res.m[j], row);
+	}
+#else
+	for (int j = 0; j < 3; j++) {
+		for (int i = 0; i < 4; i++) {
+			res.m[j][i] = rhs.m[j][0] * this->m[0][i] + rhs.m[j][1] * this->m[1][i] +
+				rhs.m[j][2] * this->m[2][i];
+		}
+		res.m[j][3] += rhs.m[j][3];
+	}
+#endif
+	return res;
 }
 
-MLMatrix4 MLMatrix4::operator * (const MLMatrix4& rhs) {
+// row i of the result is column i of lhs transforming rhs
+MLMatrix4 operator * (const MLAffine3x4 &lhs, const MLMatrix4 &rhs) {
 	MLMatrix4 res;
+#if defined(ML_SIMD_SSE2)
+	__m128 r0 = _mm_loadu_ps(rhs.m[0]);
+	__m128 r1 = _mm_loadu_ps(rhs.m[1]);
+	__m128 r2 = _mm_loadu_ps(rhs.m[2]);
+	for (int i = 0; i < 4; i++) {
+		__m128 row = _mm_mul_ps(_mm_set1_ps(lhs.m[0][i]), r0);
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(lhs.m[1][i]), r1));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(lhs.m[2][i]), r2));
+		if (i == 3)
+			row = _mm_add_ps(row, _mm_loadu_ps(rhs.m[3]));
+		_mm_storeu_ps(res.m[i], row);
+	}
+#else
 	for (int i = 0; i < 4; i++) {
-		MLVector4 row(this->m[i][0], this->m[i][1], this->m[i][2], this->m[i][3]);
 		for (int j = 0; j < 4; j++) {
-			MLVector4 col(rhs.m[0][j], rhs.m[1][j], rhs.m[2][j], rhs.m[3][j]);
-			res.m[i][j] = Vec4_Dot(&row, &col);
+			res.m[i][j] = lhs.m[0][i] * rhs.m[0][j] + lhs.m[1][i] * rhs.m[1][j] +
+				lhs.m[2][i] * rhs.m[2][j];
 		}
 	}
+	for (int j = 0; j < 4; j++)
+		res.m[3][j] += rhs.m[3][j];
+#endif
 	return res;
 }
\ No newline at end of file
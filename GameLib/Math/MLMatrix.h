@@ -1,5 +1,6 @@
 #pragma once
-struct MLMatrix {
+// rows are 16 byte aligned so SIMD kernels can load them whole
+struct alignas(16) MLMatrix {
 	union {
 		struct {
 			float _11, _12, _13, _14;
@@ -9,17 +10,30 @@ struct MLMatrix {
 		};
 		float m[4][4];
 	};
+	MLMatrix() {};
+	// constant expression when the arguments are, m is the member initialized
+	constexpr MLMatrix(
+		float _11, float _12, float _13, float _14,
+		float _21, float _22, float _23, float _24,
+		float _31, float _32, float _33, float _34,
+		float _41, float _42, float _43, float _44
+	) : m{
+		{ _11, _12, _13, _14 },
+		{ _21, _22, _23, _24 },
+		{ _31, _32, _33, _34 },
+		{ _41, _42, _43, _44 } } {}
 };
 
 class MLMatrix4 : public MLMatrix {
 public:
 	MLMatrix4() {};
-	MLMatrix4(
+	constexpr MLMatrix4(
 		float _11, float _12, float _13, float _14,
 		float _21, float _22, float _23, float _24,
 		float _31, float _32, float _33, float _34,
 		float _41, float _42, float _43, float _44
-	);
+	) : MLMatrix(_11, _12, _13, _14, _21, _22, _23, _24, _31, _32, _33, _34,
+		_41, _42, _43, _44) {}
 	// binary operators
-	MLMatrix4 operator * (const MLMatrix4&);
-};
\ No newline at end of file
+	MLMatrix4 operator * (const MLMatrix4&) const;
+};
@@ -5,10 +5,5 @@ public:
 	// plane: np + d = 0
 	float a, b, c, d;
 	MLPlane() {};
-	MLPlane(float a, float b, float c, float d) {
-		this->a = a;
-		this->b = b;
-		this->c = c;
-		this->d = d;
-	}
+	constexpr MLPlane(float a, float b, float c, float d) : a(a), b(b), c(c), d(d) {}
 };
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+// rotation quaternion, w is the real part
+class alignas(16) MLQuaternion {
+public:
+	// members
+	float x, y, z, w;
+	// constructors
+	MLQuaternion() {};
+	constexpr MLQuaternion(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	// unary operators
+	constexpr MLQuaternion operator - () const {
+		return MLQuaternion(-x, -y, -z, -w);
+	}
+	// binary operators
+	// rotation of this followed by rhs, same order as the matrices: R(a * b) == R(a) * R(b)
+	constexpr MLQuaternion operator * (const MLQuaternion &rhs) const {
+		return MLQuaternion(
+			rhs.w * x + rhs.x * w + rhs.y * z - rhs.z * y,
+			rhs.w * y - rhs.x * z + rhs.y * w + rhs.z * x,
+			rhs.w * z + rhs.x * y - rhs.y * x + rhs.z * w,
+			rhs.w * w - rhs.x * x - rhs.y * y - rhs.z * z);
+	}
+	constexpr MLQuaternion operator + (const MLQuaternion &rhs) const {
+		return MLQuaternion(x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w);
+	}
+	constexpr MLQuaternion operator * (float rhs) const {
+		return MLQuaternion(x * rhs, y * rhs, z * rhs, w * rhs);
+	}
+};
@@ -0,0 +1,12 @@
+#pragma once
+#include <math.h>
+const float EPSILON = 0.001f;
+
+inline bool Float_Equals(float lhs, float rhs) {
+	return fabs(lhs - rhs) < EPSILON ? true : false;
+}
+
+// linear interploation
+inline float LinearInterpolation(float x1, float x2, float factor) {
+	return x1 + factor * (x2 - x1);
+}
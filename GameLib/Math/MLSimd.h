@@ -0,0 +1,29 @@
+#pragma once
+
+/****************************************************
+* Compile time SIMD selection
+* ML_SIMD_AVX2: 8 wide float and int
+* ML_SIMD_AVX: 8 wide float
+* ML_SIMD_SSE2: 4 wide float and int
+* none of them: scalar fallback
+* Define ML_SIMD_DISABLE to force the scalar path.
+*/
+
+#if !defined(ML_SIMD_DISABLE)
+#if defined(__AVX2__)
+#define ML_SIMD_AVX2 1
+#endif
+#if defined(__AVX__)
+#define ML_SIMD_AVX 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || \
+	defined(ML_SIMD_AVX)
+#define ML_SIMD_SSE2 1
+#endif
+#endif
+
+#if defined(ML_SIMD_AVX)
+#include <immintrin.h>
+#elif defined(ML_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
@@ -0,0 +1,74 @@
+#include "MLStream.h"
+#include <stdlib.h>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// MLVector3Stream
+MLVector3Stream::MLVector3Stream() : x(nullptr), y(nullptr), z(nullptr), count(0), capacity(0) {
+}
+
+MLVector3Stream::MLVector3Stream(int count) : x(nullptr), y(nullptr), z(nullptr), count(0),
+	capacity(0) {
+	MLVector3Stream::Resize(count);
+}
+
+MLVector3Stream::~MLVector3Stream() {
+	Free(x);
+	Free(y);
+	Free(z);
+}
+
+void MLVector3Stream::Resize(int count) {
+	this->count = count;
+	int padded = (count + ML_STREAM_BATCH - 1) / ML_STREAM_BATCH * ML_STREAM_BATCH;
+	if (padded <= capacity)
+		return;
+	Free(x);
+	Free(y);
+	Free(z);
+	x = Alloc(padded);
+	y = Alloc(padded);
+	z = Alloc(padded);
+	capacity = padded;
+}
+
+float *MLVector3Stream::Alloc(int n) {
+#ifdef _MSC_VER
+	return (float *)_aligned_malloc(sizeof(float) * n, 32);
+#else
+	void *p = nullptr;
+	if (posix_memalign(&p, 32, sizeof(float) * n) != 0)
+		return nullptr;
+	return (float *)p;
+#endif
+}
+
+void MLVector3Stream::Free(float *p) {
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+// MLVector4Stream
+MLVector4Stream::MLVector4Stream() : w(nullptr) {
+}
+
+MLVector4Stream::MLVector4Stream(int count) : w(nullptr) {
+	MLVector4Stream::Resize(count);
+}
+
+MLVector4Stream::~MLVector4Stream() {
+	Free(w);
+}
+
+void MLVector4Stream::Resize(int count) {
+	int old = capacity;
+	MLVector3Stream::Resize(count);
+	if (capacity == old && w)
+		return;
+	Free(w);
+	w = Alloc(capacity);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+/****************************************************
+* Structure of arrays vector streams for batch transforms.
+* Every component array is 32 byte aligned and padded to a
+* multiple of ML_STREAM_BATCH, so kernels never need a tail loop.
+*/
+
+// vectors processed per iteration by the widest kernel
+const int ML_STREAM_BATCH = 8;
+
+class MLVector3Stream {
+public:
+	MLVector3Stream();
+	MLVector3Stream(int count);
+	virtual ~MLVector3Stream();
+	// keeps no content when it grows
+	virtual void Resize(int count);
+	int GetCount() const { return count; }
+	// padded length of each component array
+	int GetCapacity() const { return capacity; }
+
+	float *x, *y, *z;
+	int count;
+
+protected:
+	// allocate n padded floats
+	static float *Alloc(int n);
+	static void Free(float *p);
+	int capacity;
+
+private:
+	MLVector3Stream(const MLVector3Stream &);
+	MLVector3Stream &operator = (const MLVector3Stream &);
+};
+
+class MLVector4Stream : public MLVector3Stream {
+public:
+	MLVector4Stream();
+	MLVector4Stream(int count);
+	virtual ~MLVector4Stream();
+	virtual void Resize(int count);
+
+	float *w;
+};
+
+// quaternions (x, y, z, w)
+typedef MLVector4Stream MLQuaternionStream;
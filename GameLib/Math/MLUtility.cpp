@@ -1,70 +1,126 @@
 #include "MLUtility.h"
+#include <float.h>
 
-bool Float_Equals(float lhs, float rhs) {
-	return fabs(lhs - rhs) < EPSILON ? true : false;
+// lanes of the batch kernels
+namespace {
+#if defined(ML_SIMD_AVX)
+typedef __m256 Lanes;
+const int LANES = 8;
+inline Lanes Load(const float *p) { return _mm256_load_ps(p); }
+inline void Store(float *p, Lanes v) { _mm256_store_ps(p, v); }
+inline Lanes Splat(float f) { return _mm256_set1_ps(f); }
+inline Lanes Add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+inline Lanes Mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+inline Lanes Sub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+inline Lanes Div(Lanes a, Lanes b) { return _mm256_div_ps(a, b); }
+inline Lanes Sqrt(Lanes a) { return _mm256_sqrt_ps(a); }
+inline Lanes Min(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+// a negated where b is negative
+inline Lanes FlipSign(Lanes a, Lanes b) {
+	return _mm256_xor_ps(a, _mm256_and_ps(b, _mm256_set1_ps(-0.0f)));
 }
-
-float LinearInterpolation(float x1, float x2, float factor) {
-	return x1 + factor * (x2 - x1);
+#elif defined(ML_SIMD_SSE2)
+typedef __m128 Lanes;
+const int LANES = 4;
+inline Lanes Load(const float *p) { return _mm_load_ps(p); }
+inline void Store(float *p, Lanes v) { _mm_store_ps(p, v); }
+inline Lanes Splat(float f) { return _mm_set1_ps(f); }
+inline Lanes Add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+inline Lanes Mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+inline Lanes Div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+inline Lanes Sqrt(Lanes a) { return _mm_sqrt_ps(a); }
+inline Lanes Min(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+inline Lanes FlipSign(Lanes a, Lanes b) {
+	return _mm_xor_ps(a, _mm_and_ps(b, _mm_set1_ps(-0.0f)));
 }
-
-float Vec3_Length(const MLVector3 *pV) {
-	return sqrtf(pV->x * pV->x + pV->y * pV->y + pV->z * pV->z);
+#else
+typedef float Lanes;
+const int LANES = 1;
+inline Lanes Load(const float *p) { return *p; }
+inline void Store(float *p, Lanes v) { *p = v; }
+inline Lanes Splat(float f) { return f; }
+inline Lanes Add(Lanes a, Lanes b) { return a + b; }
+inline Lanes Mul(Lanes a, Lanes b) { return a * b; }
+inline Lanes Sub(Lanes a, Lanes b) { return a - b; }
+inline Lanes Div(Lanes a, Lanes b) { return a / b; }
+inline Lanes Sqrt(Lanes a) { return sqrtf(a); }
+inline Lanes Min(Lanes a, Lanes b) { return a < b ? a : b; }
+inline Lanes FlipSign(Lanes a, Lanes b) { return b < 0.0f ? -a : a; }
+#endif
+static_assert(ML_STREAM_BATCH % LANES == 0, "streams must be padded to whole batches");
 }
 
-MLVector3 *Vec3_Normalize(MLVector3 *pOut, const MLVector3 *pV) {
-	*pOut = *pV / Vec3_Length(pV);
+// streams are padded to whole batches, so the kernels run past count into the padding
+MLVector4Stream *Vec4_TransformStream(MLVector4Stream *pOut, const MLVector4Stream *pIn,
+	const MLMatrix4 *pM) {
+	pOut->Resize(pIn->count);
+	Lanes m[4][4];
+	for (int i = 0; i < 16; i++)
+		m[i >> 2][i & 3] = Splat(pM->m[i >> 2][i & 3]);
+	float *out[4] = { pOut->x, pOut->y, pOut->z, pOut->w };
+	for (int i = 0; i < pIn->count; i += LANES) {
+		Lanes x = Load(pIn->x + i), y = Load(pIn->y + i);
+		Lanes z = Load(pIn->z + i), w = Load(pIn->w + i);
+		for (int j = 0; j < 4; j++) {
+			Lanes r = Add(Add(Add(Mul(x, m[0][j]), Mul(y, m[1][j])), Mul(z, m[2][j])),
+				Mul(w, m[3][j]));
+			Store(out[j] + i, r);
+		}
+	}
 	return pOut;
 }
 
-float Vec3_Dot(const MLVector3 *pV1, const MLVector3 *pV2) {
-	return pV1->x * pV2->x + pV1->y * pV2->y + pV1->z * pV2->z;
-}
-
-float Vec4_Dot(const MLVector4 *pV1, const MLVector4 *pV2) {
-	return pV1->x * pV2->x + pV1->y * pV2->y + pV1->z * pV2->z + pV1->w * pV2->w;
-}
-
-MLVector3 *Vec3_Cross(MLVector3 *pOut, const MLVector3 *pV1, const MLVector3 *pV2) {
-	*pOut = MLVector3(
-		pV1->y * pV2->z - pV1->z * pV2->y,
-		pV1->z * pV2->x - pV1->x * pV2->z,
-		pV1->x * pV2->y - pV1->y * pV2->x
-	);
+// the last column is (0, 0, 0, 1), so w is unchanged
+MLVector4Stream *Vec4_TransformStream(MLVector4Stream *pOut, const MLVector4Stream *pIn,
+	const MLAffine3x4 *pA) {
+	pOut->Resize(pIn->count);
+	Lanes m[4][3];
+	for (int i = 0; i < 12; i++)
+		m[i / 3][i % 3] = Splat(pA->m[i % 3][i / 3]);
+	float *out[3] = { pOut->x, pOut->y, pOut->z };
+	for (int i = 0; i < pIn->count; i += LANES) {
+		Lanes x = Load(pIn->x + i), y = Load(pIn->y + i);
+		Lanes z = Load(pIn->z + i), w = Load(pIn->w + i);
+		for (int j = 0; j < 3; j++) {
+			Lanes r = Add(Add(Add(Mul(x, m[0][j]), Mul(y, m[1][j])), Mul(z, m[2][j])),
+				Mul(w, m[3][j]));
+			Store(out[j] + i, r);
+		}
+		Store(pOut->w + i, w);
+	}
 	return pOut;
 }
 
-MLVector4 *Vec4_Transform(MLVector4 *pOut, const MLVector4 *pV, const MLMatrix4 *pM) {
-	MLVector4 result;
-	for (int i = 0; i < 4; i++) {
-		MLVector4 rhs(pM->m[0][i], pM->m[1][i], pM->m[2][i], pM->m[3][i]);
-		float val = Vec4_Dot(pV, &rhs);
-		switch (i) {
-		case 0:
-			result.x = val;
-			break;
-		case 1:
-			result.y = val;
-			break;
-		case 2:
-			result.z = val;
-			break;
-		case 3:
-			result.w = val;
-			break;
+MLVector4Stream *Vec3_TransformCoordStream(MLVector4Stream *pOut, const MLVector3Stream *pIn,
+	const MLMatrix4 *pM) {
+	pOut->Resize(pIn->count);
+	Lanes m[4][4];
+	for (int i = 0; i < 16; i++)
+		m[i >> 2][i & 3] = Splat(pM->m[i >> 2][i & 3]);
+	float *out[4] = { pOut->x, pOut->y, pOut->z, pOut->w };
+	for (int i = 0; i < pIn->count; i += LANES) {
+		Lanes x = Load(pIn->x + i), y = Load(pIn->y + i), z = Load(pIn->z + i);
+		for (int j = 0; j < 4; j++) {
+			Lanes r = Add(Add(Add(Mul(x, m[0][j]), Mul(y, m[1][j])), Mul(z, m[2][j])), m[3][j]);
+			Store(out[j] + i, r);
 		}
 	}
-	*pOut = result;
 	return pOut;
 }
 
-MLMatrix4 *Matrix_Translation(MLMatrix4 *pOut, float x, float y, float z) {
-	*pOut = MLMatrix4(
-		1, 0, 0, 0,
-		0, 1, 0, 0,
-		0, 0, 1, 0,
-		x, y, z, 1
-	);
+MLVector3Stream *Vec3_TransformNormalStream(MLVector3Stream *pOut, const MLVector3Stream *pIn,
+	const MLMatrix4 *pM) {
+	pOut->Resize(pIn->count);
+	Lanes m[3][3];
+	for (int i = 0; i < 9; i++)
+		m[i / 3][i % 3] = Splat(pM->m[i / 3][i % 3]);
+	float *out[3] = { pOut->x, pOut->y, pOut->z };
+	for (int i = 0; i < pIn->count; i += LANES) {
+		Lanes x = Load(pIn->x + i), y = Load(pIn->y + i), z = Load(pIn->z + i);
+		for (int j = 0; j < 3; j++)
+			Store(out[j] + i, Add(Add(Mul(x, m[0][j]), Mul(y, m[1][j])), Mul(z, m[2][j])));
+	}
 	return pOut;
 }
 
@@ -98,41 +154,140 @@ MLMatrix4 *Matrix_RotationZ(MLMatrix4 *pOut, float angle) {
 	return pOut;
 }
 
-MLMatrix4 *Matrix_Scaling(MLMatrix4 *pOut, float sx, float sy, float sz) {
-	*pOut = MLMatrix4(
-		sx, 0, 0, 0,
-		0, sy, 0, 0,
-		0, 0, sz, 0,
-		0, 0, 0, 1
-	);
-	return pOut;
+#if defined(ML_SIMD_SSE2)
+// 2x2 matrices packed row major in one register, (m00, m01, m10, m11)
+namespace {
+#define ML_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define ML_SWIZZLE(a, x, y, z, w) ML_SHUFFLE(a, a, x, y, z, w)
+// a * b
+inline __m128 Mat2Mul(__m128 a, __m128 b) {
+	return _mm_add_ps(_mm_mul_ps(a, ML_SWIZZLE(b, 0, 3, 0, 3)),
+		_mm_mul_ps(ML_SWIZZLE(a, 1, 0, 3, 2), ML_SWIZZLE(b, 2, 1, 2, 1)));
+}
+// adj(a) * b
+inline __m128 Mat2AdjMul(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(ML_SWIZZLE(a, 3, 3, 0, 0), b),
+		_mm_mul_ps(ML_SWIZZLE(a, 1, 1, 2, 2), ML_SWIZZLE(b, 2, 3, 0, 1)));
+}
+// a * adj(b)
+inline __m128 Mat2MulAdj(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(a, ML_SWIZZLE(b, 3, 0, 3, 0)),
+		_mm_mul_ps(ML_SWIZZLE(a, 1, 0, 3, 2), ML_SWIZZLE(b, 2, 1, 2, 1)));
 }
+}
+#endif
 
-MLMatrix4 *Matrix_Transpose(MLMatrix4 *pOut, const MLMatrix4 *pM) {
-	for (int i = 0; i < 4; i++) {
-		for (int j = 0; j < 4; j++) {
-			pOut->m[j][i] = pM->m[i][j];
-		}
-	}
+// blockwise inversion over 2x2 sub matrices
+MLMatrix4 *Matrix_Inverse(MLMatrix4 *pOut, const MLMatrix4 *pM) {
+#if defined(ML_SIMD_SSE2)
+	__m128 r0 = _mm_loadu_ps(pM->m[0]), r1 = _mm_loadu_ps(pM->m[1]);
+	__m128 r2 = _mm_loadu_ps(pM->m[2]), r3 = _mm_loadu_ps(pM->m[3]);
+	// M = | A B |
+	//     | C D |
+	__m128 A = _mm_movelh_ps(r0, r1), B = _mm_movehl_ps(r1, r0);
+	__m128 C = _mm_movelh_ps(r2, r3), D = _mm_movehl_ps(r3, r2);
+	// determinants of A, B, C and D
+	__m128 det = _mm_sub_ps(
+		_mm_mul_ps(ML_SHUFFLE(r0, r2, 0, 2, 0, 2), ML_SHUFFLE(r1, r3, 1, 3, 1, 3)),
+		_mm_mul_ps(ML_SHUFFLE(r0, r2, 1, 3, 1, 3), ML_SHUFFLE(r1, r3, 0, 2, 0, 2)));
+	__m128 detA = ML_SWIZZLE(det, 0, 0, 0, 0), detB = ML_SWIZZLE(det, 1, 1, 1, 1);
+	__m128 detC = ML_SWIZZLE(det, 2, 2, 2, 2), detD = ML_SWIZZLE(det, 3, 3, 3, 3);
+	__m128 DC = Mat2AdjMul(D, C), AB = Mat2AdjMul(A, B);
+	__m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), Mat2Mul(B, DC));
+	__m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), Mat2Mul(C, AB));
+	__m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), Mat2MulAdj(D, AB));
+	__m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), Mat2MulAdj(A, DC));
+	// |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+	__m128 tr = _mm_mul_ps(AB, ML_SWIZZLE(DC, 0, 2, 1, 3));
+	tr = _mm_add_ps(tr, ML_SWIZZLE(tr, 1, 0, 3, 2));
+	tr = _mm_add_ps(tr, ML_SWIZZLE(tr, 2, 3, 0, 1));
+	__m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+	__m128 rdet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+	X = _mm_mul_ps(X, rdet);
+	Y = _mm_mul_ps(Y, rdet);
+	Z = _mm_mul_ps(Z, rdet);
+	W = _mm_mul_ps(W, rdet);
+	// adjugate blocks back to rows
+	_mm_storeu_ps(pOut->m[0], ML_SHUFFLE(X, Y, 3, 1, 3, 1));
+	_mm_storeu_ps(pOut->m[1], ML_SHUFFLE(X, Y, 2, 0, 2, 0));
+	_mm_storeu_ps(pOut->m[2], ML_SHUFFLE(Z, W, 3, 1, 3, 1));
+	_mm_storeu_ps(pOut->m[3], ML_SHUFFLE(Z, W, 2, 0, 2, 0));
+#undef ML_SWIZZLE
+#undef ML_SHUFFLE
+#else
+	const MLMatrix4 a = *pM;
+	// 2x2 determinants of the upper and the lower two rows
+	float s0 = a._11 * a._22 - a._21 * a._12;
+	float s1 = a._11 * a._23 - a._21 * a._13;
+	float s2 = a._11 * a._24 - a._21 * a._14;
+	float s3 = a._12 * a._23 - a._22 * a._13;
+	float s4 = a._12 * a._24 - a._22 * a._14;
+	float s5 = a._13 * a._24 - a._23 * a._14;
+	float c5 = a._33 * a._44 - a._43 * a._34;
+	float c4 = a._32 * a._44 - a._42 * a._34;
+	float c3 = a._32 * a._43 - a._42 * a._33;
+	float c2 = a._31 * a._44 - a._41 * a._34;
+	float c1 = a._31 * a._43 - a._41 * a._33;
+	float c0 = a._31 * a._42 - a._41 * a._32;
+	float rdet = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+	pOut->_11 = (a._22 * c5 - a._23 * c4 + a._24 * c3) * rdet;
+	pOut->_12 = (-a._12 * c5 + a._13 * c4 - a._14 * c3) * rdet;
+	pOut->_13 = (a._42 * s5 - a._43 * s4 + a._44 * s3) * rdet;
+	pOut->_14 = (-a._32 * s5 + a._33 * s4 - a._34 * s3) * rdet;
+	pOut->_21 = (-a._21 * c5 + a._23 * c2 - a._24 * c1) * rdet;
+	pOut->_22 = (a._11 * c5 - a._13 * c2 + a._14 * c1) * rdet;
+	pOut->_23 = (-a._41 * s5 + a._43 * s2 - a._44 * s1) * rdet;
+	pOut->_24 = (a._31 * s5 - a._33 * s2 + a._34 * s1) * rdet;
+	pOut->_31 = (a._21 * c4 - a._22 * c2 + a._24 * c0) * rdet;
+	pOut->_32 = (-a._11 * c4 + a._12 * c2 - a._14 * c0) * rdet;
+	pOut->_33 = (a._41 * s4 - a._42 * s2 + a._44 * s0) * rdet;
+	pOut->_34 = (-a._31 * s4 + a._32 * s2 - a._34 * s0) * rdet;
+	pOut->_41 = (-a._21 * c3 + a._22 * c1 - a._23 * c0) * rdet;
+	pOut->_42 = (a._11 * c3 - a._12 * c1 + a._13 * c0) * rdet;
+	pOut->_43 = (-a._41 * s3 + a._42 * s1 - a._43 * s0) * rdet;
+	pOut->_44 = (a._31 * s3 - a._32 * s1 + a._33 * s0) * rdet;
+#endif
 	return pOut;
 }
 
-MLMatrix4 *Matrix_Inverse(MLMatrix4 *pOut, const MLMatrix4 *pM) {
-	for (int i = 0; i < 4; i++) {
-		for (int j = 0; j < 4; j++) {
-			pOut->m[j][i] = Cofactor3x3(pM, i, j);
-		}
+// rows of the cofactor matrix of the upper 3x3 are cross products of its rows
+static float Cofactors3x3(float c[3][3], const MLMatrix4 *pM) {
+	for (int i = 0; i < 3; i++) {
+		const float *a = pM->m[(i + 1) % 3], *b = pM->m[(i + 2) % 3];
+		c[i][0] = a[1] * b[2] - a[2] * b[1];
+		c[i][1] = a[2] * b[0] - a[0] * b[2];
+		c[i][2] = a[0] * b[1] - a[1] * b[0];
 	}
+	return pM->_11 * c[0][0] + pM->_12 * c[0][1] + pM->_13 * c[0][2];
+}
 
-	float det = 0.0f;
-	for (int i = 0; i < 4; i++)
-		det += pM->m[0][i] * pOut->m[i][0];
+MLMatrix4 *Matrix_InverseAffine(MLMatrix4 *pOut, const MLMatrix4 *pM) {
+	float c[3][3];
+	float rdet = 1.0f / Cofactors3x3(c, pM);
+	float tx = pM->_41, ty = pM->_42, tz = pM->_43;
+	// inverse of the 3x3 is the transposed cofactors over the determinant
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++)
+			pOut->m[i][j] = c[j][i] * rdet;
+		pOut->m[i][3] = 0.0f;
+	}
+	// translation is -t * inverse
+	for (int j = 0; j < 3; j++)
+		pOut->m[3][j] = -(tx * pOut->m[0][j] + ty * pOut->m[1][j] + tz * pOut->m[2][j]);
+	pOut->_44 = 1.0f;
+	return pOut;
+}
 
-	for (int i = 0; i < 4; i++) {
-		for (int j = 0; j < 4; j++) {
-			pOut->m[j][i] /= det;
-		}
+MLMatrix4 *Matrix_InverseTranspose3x3(MLMatrix4 *pOut, const MLMatrix4 *pM) {
+	float c[3][3];
+	float rdet = 1.0f / Cofactors3x3(c, pM);
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++)
+			pOut->m[i][j] = c[i][j] * rdet;
+		pOut->m[i][3] = 0.0f;
+		pOut->m[3][i] = 0.0f;
 	}
+	pOut->_44 = 1.0f;
 	return pOut;
 }
 
@@ -151,20 +306,17 @@ float Cofactor3x3(const MLMatrix4 *pM, int row, int col) {
 		x++;
 	}
 	float res = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] -
-		m[1][2] * m[2][0]) + m[0][2] * (m[1][0] * m[2][1] - m[1][2] * m[2][0]);
+		m[1][2] * m[2][0]) + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
 	if ((row + col) & 0x1)
 		res = -res;
 	return res;
 }
 
-float Plane_DotCoord(const MLPlane *pP, const MLVector3 *pV) {
-	return Vec3_Dot(&MLVector3(pP->a, pP->b, pP->c), pV) + pP->d;
-}
-
 MLMatrix4 *Matrix_LookAt(MLMatrix4 *pOut, const MLVector3 *pEye, const MLVector3 *pAt,
 	const MLVector3 *pUp) {
 	MLVector3 xaxis, yaxis, zaxis;
-	Vec3_Normalize(&zaxis, &(*pAt - *pEye));
+	zaxis = *pAt - *pEye;
+	Vec3_Normalize(&zaxis, &zaxis);
 	Vec3_Cross(&xaxis, pUp, &zaxis);
 	Vec3_Normalize(&xaxis, &xaxis);
 	Vec3_Cross(&yaxis, &zaxis, &xaxis);
@@ -189,15 +341,227 @@ MLMatrix4 *Matrix_PerspectiveFov(MLMatrix4 *pOut, float fovY, float Aspect, floa
 	return pOut;
 }
 
-MLMatrix4 *Matrix_Viewport(MLMatrix4 *pOut, float x, float y, int width, int height, 
-	float minZ, float maxZ) {
-	float halfW = width * 0.5f;
-	float halfH = height * 0.5f;
-	*pOut = MLMatrix4(
-		halfW, 0, 0, 0,
-		0, -halfH, 0, 0,
-		0, 0, maxZ - minZ, 0,
-		x + halfW, y + halfH, minZ, 1
+MLQuaternion Quat_RotationAxis(const MLVector3 &axis, float angle) {
+	MLVector3 v = Vec3_Normalize(axis) * sinf(angle * 0.5f);
+	return MLQuaternion(v.x, v.y, v.z, cosf(angle * 0.5f));
+}
+
+// from the largest of w, x, y and z so the division is well conditioned
+MLQuaternion Quat_RotationMatrix(const MLMatrix4 &m) {
+	float trace = m._11 + m._22 + m._33;
+	if (trace > 0.0f) {
+		float s = 0.5f / sqrtf(trace + 1.0f);
+		return MLQuaternion((m._23 - m._32) * s, (m._31 - m._13) * s, (m._12 - m._21) * s,
+			0.25f / s);
+	}
+	if (m._11 > m._22 && m._11 > m._33) {
+		float s = 2.0f * sqrtf(1.0f + m._11 - m._22 - m._33);
+		return MLQuaternion(0.25f * s, (m._21 + m._12) / s, (m._31 + m._13) / s,
+			(m._23 - m._32) / s);
+	}
+	if (m._22 > m._33) {
+		float s = 2.0f * sqrtf(1.0f + m._22 - m._11 - m._33);
+		return MLQuaternion((m._21 + m._12) / s, 0.25f * s, (m._32 + m._23) / s,
+			(m._31 - m._13) / s);
+	}
+	float s = 2.0f * sqrtf(1.0f + m._33 - m._11 - m._22);
+	return MLQuaternion((m._31 + m._13) / s, (m._32 + m._23) / s, 0.25f * s,
+		(m._12 - m._21) / s);
+}
+
+MLMatrix4 Matrix_RotationQuaternion(const MLQuaternion &q) {
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	return MLMatrix4(
+		1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0,
+		2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0,
+		2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0,
+		0, 0, 0, 1
 	);
+}
+
+MLQuaternion Quat_Slerp(const MLQuaternion &q1, const MLQuaternion &q2, float t) {
+	float cosine = Quat_Dot(q1, q2);
+	MLQuaternion end = cosine < 0.0f ? -q2 : q2;
+	cosine = fabsf(cosine);
+	// nearly the same rotation, sin(angle) is too small to divide by
+	if (cosine > 1.0f - EPSILON)
+		return Quat_Normalize(q1 * (1.0f - t) + end * t);
+	float angle = acosf(cosine);
+	float oneoversin = 1.0f / sinf(angle);
+	return q1 * (sinf((1.0f - t) * angle) * oneoversin) + end * (sinf(t * angle) * oneoversin);
+}
+
+MLQuaternionStream *Quat_MultiplyStream(MLQuaternionStream *pOut, const MLQuaternionStream *pQ1,
+	const MLQuaternionStream *pQ2) {
+	pOut->Resize(pQ1->count);
+	for (int i = 0; i < pQ1->count; i += LANES) {
+		Lanes ax = Load(pQ1->x + i), ay = Load(pQ1->y + i), az = Load(pQ1->z + i);
+		Lanes aw = Load(pQ1->w + i);
+		Lanes bx = Load(pQ2->x + i), by = Load(pQ2->y + i), bz = Load(pQ2->z + i);
+		Lanes bw = Load(pQ2->w + i);
+		// same terms as MLQuaternion::operator *
+		Store(pOut->x + i, Sub(Add(Add(Mul(bw, ax), Mul(bx, aw)), Mul(by, az)), Mul(bz, ay)));
+		Store(pOut->y + i, Add(Add(Sub(Mul(bw, ay), Mul(bx, az)), Mul(by, aw)), Mul(bz, ax)));
+		Store(pOut->z + i, Add(Sub(Add(Mul(bw, az), Mul(bx, ay)), Mul(by, ax)), Mul(bz, aw)));
+		Store(pOut->w + i, Sub(Sub(Sub(Mul(bw, aw), Mul(bx, ax)), Mul(by, ay)), Mul(bz, az)));
+	}
+	return pOut;
+}
+
+MLQuaternionStream *Quat_NormalizeStream(MLQuaternionStream *pOut, const MLQuaternionStream *pQ1) {
+	pOut->Resize(pQ1->count);
+	Lanes one = Splat(1.0f);
+	for (int i = 0; i < pQ1->count; i += LANES) {
+		Lanes x = Load(pQ1->x + i), y = Load(pQ1->y + i), z = Load(pQ1->z + i);
+		Lanes w = Load(pQ1->w + i);
+		Lanes dot = Add(Add(Add(Mul(x, x), Mul(y, y)), Mul(z, z)), Mul(w, w));
+		Lanes s = Div(one, Sqrt(dot));
+		Store(pOut->x + i, Mul(x, s));
+		Store(pOut->y + i, Mul(y, s));
+		Store(pOut->z + i, Mul(z, s));
+		Store(pOut->w + i, Mul(w, s));
+	}
+	return pOut;
+}
+
+MLQuaternionStream *Quat_NlerpStream(MLQuaternionStream *pOut, const MLQuaternionStream *pQ1,
+	const MLQuaternionStream *pQ2, float t) {
+	pOut->Resize(pQ1->count);
+	Lanes one = Splat(1.0f), t1 = Splat(1.0f - t), t2 = Splat(t);
+	for (int i = 0; i < pQ1->count; i += LANES) {
+		Lanes ax = Load(pQ1->x + i), ay = Load(pQ1->y + i), az = Load(pQ1->z + i);
+		Lanes aw = Load(pQ1->w + i);
+		Lanes bx = Load(pQ2->x + i), by = Load(pQ2->y + i), bz = Load(pQ2->z + i);
+		Lanes bw = Load(pQ2->w + i);
+		// shorter arc, weight of q2 takes the sign of the dot product
+		Lanes dot = Add(Add(Add(Mul(ax, bx), Mul(ay, by)), Mul(az, bz)), Mul(aw, bw));
+		Lanes w2 = FlipSign(t2, dot);
+		Lanes x = Add(Mul(ax, t1), Mul(bx, w2)), y = Add(Mul(ay, t1), Mul(by, w2));
+		Lanes z = Add(Mul(az, t1), Mul(bz, w2)), w = Add(Mul(aw, t1), Mul(bw, w2));
+		Lanes s = Div(one, Sqrt(Add(Add(Add(Mul(x, x), Mul(y, y)), Mul(z, z)), Mul(w, w))));
+		Store(pOut->x + i, Mul(x, s));
+		Store(pOut->y + i, Mul(y, s));
+		Store(pOut->z + i, Mul(z, s));
+		Store(pOut->w + i, Mul(w, s));
+	}
+	return pOut;
+}
+
+MLFrustum Frustum_FromMatrix(const MLMatrix4 &m) {
+	// clip space -w <= x <= w, -w <= y <= w and 0 <= z <= w, each a column combination
+	MLFrustum f;
+	f.planes[0] = MLPlane(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41);
+	f.planes[1] = MLPlane(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41);
+	f.planes[2] = MLPlane(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42);
+	f.planes[3] = MLPlane(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42);
+	f.planes[4] = MLPlane(m._13, m._23, m._33, m._43);
+	f.planes[5] = MLPlane(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43);
+	for (int i = 0; i < 6; i++)
+		f.planes[i] = Plane_Normalize(f.planes[i]);
+	return f;
+}
+
+// a < b ? a : b like minss, fminf is a library call
+static inline float MinFloat(float a, float b) {
+	return a < b ? a : b;
+}
+
+// lo and hi: smallest distance minus and plus the radius over the planes
+static int ClassifyBound(float lo, float hi) {
+	if (hi < 0.0f)
+		return ML_OUTSIDE;
+	return lo >= 0.0f ? ML_INSIDE : ML_INTERSECT;
+}
+
+int Frustum_ClassifySphere(const MLFrustum &f, const MLVector3 &center, float radius) {
+	float lo = FLT_MAX, hi = FLT_MAX;
+	for (int i = 0; i < 6; i++) {
+		float d = Plane_DotCoord(f.planes[i], center);
+		lo = MinFloat(d - radius, lo);
+		hi = MinFloat(d + radius, hi);
+	}
+	return ClassifyBound(lo, hi);
+}
+
+// a box is a sphere whose radius is its extent along each plane normal
+int Frustum_ClassifyAABB(const MLFrustum &f, const MLVector3 &boxmin, const MLVector3 &boxmax) {
+	MLVector3 center((boxmin.x + boxmax.x) * 0.5f, (boxmin.y + boxmax.y) * 0.5f,
+		(boxmin.z + boxmax.z) * 0.5f);
+	MLVector3 extent((boxmax.x - boxmin.x) * 0.5f, (boxmax.y - boxmin.y) * 0.5f,
+		(boxmax.z - boxmin.z) * 0.5f);
+	float lo = FLT_MAX, hi = FLT_MAX;
+	for (int i = 0; i < 6; i++) {
+		const MLPlane &p = f.planes[i];
+		float d = Plane_DotCoord(p, center);
+		float r = fabsf(p.a) * extent.x + fabsf(p.b) * extent.y + fabsf(p.c) * extent.z;
+		lo = MinFloat(d - r, lo);
+		hi = MinFloat(d + r, hi);
+	}
+	return ClassifyBound(lo, hi);
+}
+
+unsigned char *Frustum_ClassifySphereStream(unsigned char *pOut, const MLFrustum *pF,
+	const MLVector4Stream *pSpheres) {
+	Lanes p[6][4];
+	for (int i = 0; i < 6; i++) {
+		const MLPlane &plane = pF->planes[i];
+		p[i][0] = Splat(plane.a); p[i][1] = Splat(plane.b);
+		p[i][2] = Splat(plane.c); p[i][3] = Splat(plane.d);
+	}
+	alignas(32) float lo[LANES], hi[LANES];
+	for (int i = 0; i < pSpheres->count; i += LANES) {
+		Lanes x = Load(pSpheres->x + i), y = Load(pSpheres->y + i);
+		Lanes z = Load(pSpheres->z + i), r = Load(pSpheres->w + i);
+		Lanes l = Splat(FLT_MAX), h = Splat(FLT_MAX);
+		for (int k = 0; k < 6; k++) {
+			Lanes d = Add(Add(Add(Mul(p[k][0], x), Mul(p[k][1], y)), Mul(p[k][2], z)), p[k][3]);
+			l = Min(Sub(d, r), l);
+			h = Min(Add(d, r), h);
+		}
+		Store(lo, l);
+		Store(hi, h);
+		// the padding lanes are not written out
+		int n = pSpheres->count - i < LANES ? pSpheres->count - i : LANES;
+		for (int j = 0; j < n; j++)
+			pOut[i + j] = (unsigned char)ClassifyBound(lo[j], hi[j]);
+	}
+	return pOut;
+}
+
+unsigned char *Frustum_ClassifyAABBStream(unsigned char *pOut, const MLFrustum *pF,
+	const MLVector3Stream *pMin, const MLVector3Stream *pMax) {
+	Lanes p[6][4], absp[6][3];
+	for (int i = 0; i < 6; i++) {
+		const MLPlane &plane = pF->planes[i];
+		p[i][0] = Splat(plane.a); p[i][1] = Splat(plane.b);
+		p[i][2] = Splat(plane.c); p[i][3] = Splat(plane.d);
+		absp[i][0] = Splat(fabsf(plane.a));
+		absp[i][1] = Splat(fabsf(plane.b));
+		absp[i][2] = Splat(fabsf(plane.c));
+	}
+	Lanes half = Splat(0.5f);
+	alignas(32) float lo[LANES], hi[LANES];
+	for (int i = 0; i < pMin->count; i += LANES) {
+		Lanes minx = Load(pMin->x + i), miny = Load(pMin->y + i), minz = Load(pMin->z + i);
+		Lanes maxx = Load(pMax->x + i), maxy = Load(pMax->y + i), maxz = Load(pMax->z + i);
+		Lanes x = Mul(Add(minx, maxx), half), y = Mul(Add(miny, maxy), half);
+		Lanes z = Mul(Add(minz, maxz), half);
+		Lanes ex = Mul(Sub(maxx, minx), half), ey = Mul(Sub(maxy, miny), half);
+		Lanes ez = Mul(Sub(maxz, minz), half);
+		Lanes l = Splat(FLT_MAX), h = Splat(FLT_MAX);
+		for (int k = 0; k < 6; k++) {
+			Lanes d = Add(Add(Add(Mul(p[k][0], x), Mul(p[k][1], y)), Mul(p[k][2], z)), p[k][3]);
+			Lanes r = Add(Add(Mul(absp[k][0], ex), Mul(absp[k][1], ey)), Mul(absp[k][2], ez));
+			l = Min(Sub(d, r), l);
+			h = Min(Add(d, r), h);
+		}
+		Store(lo, l);
+		Store(hi, h);
+		int n = pMin->count - i < LANES ? pMin->count - i : LANES;
+		for (int j = 0; j < n; j++)
+			pOut[i + j] = (unsigned char)ClassifyBound(lo[j], hi[j]);
+	}
 	return pOut;
 }
\ No newline at end of file
@@ -1,28 +1,118 @@
 #pragma once
 #include <math.h>
+#include "MLScalar.h"
 #include "MLVector.h"
 #include "MLMatrix.h"
+#include "MLAffine.h"
 #include "MLPlane.h"
-const float EPSILON = 0.001f;
+#include "MLQuaternion.h"
+#include "MLFrustum.h"
+#include "MLStream.h"
+#include "MLSimd.h"
 
-bool Float_Equals(float lhs, float rhs);
+/****************************************************
+* Small operations are inline so they fold into the callers' loops.
+* They and the quaternion functions have a value returning overload
+* taking references, the pointer one forwards to it.
+*/
 
-// linear interploation
-float LinearInterpolation(float x1, float x2, float factor);
+inline float Vec3_Length(const MLVector3 &v) {
+	return sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+}
+inline float Vec3_Length(const MLVector3 *pV) {
+	return Vec3_Length(*pV);
+}
 
-float Vec3_Length(const MLVector3 *pV);
+inline MLVector3 Vec3_Normalize(const MLVector3 &v) {
+	return v / Vec3_Length(v);
+}
+inline MLVector3 *Vec3_Normalize(MLVector3 *pOut, const MLVector3 *pV) {
+	*pOut = Vec3_Normalize(*pV);
+	return pOut;
+}
 
-MLVector3 *Vec3_Normalize(MLVector3 *pOut, const MLVector3 *pV);
+inline float Vec3_Dot(const MLVector3 &v1, const MLVector3 &v2) {
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+inline float Vec3_Dot(const MLVector3 *pV1, const MLVector3 *pV2) {
+	return Vec3_Dot(*pV1, *pV2);
+}
 
-float Vec3_Dot(const MLVector3 *pV1, const MLVector3 *pV2);
+inline float Vec4_Dot(const MLVector4 &v1, const MLVector4 &v2) {
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
+}
+inline float Vec4_Dot(const MLVector4 *pV1, const MLVector4 *pV2) {
+	return Vec4_Dot(*pV1, *pV2);
+}
 
-float Vec4_Dot(const MLVector4 *pV1, const MLVector4 *pV2);
+inline MLVector3 Vec3_Cross(const MLVector3 &v1, const MLVector3 &v2) {
+	return MLVector3(v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z,
+		v1.x * v2.y - v1.y * v2.x);
+}
+inline MLVector3 *Vec3_Cross(MLVector3 *pOut, const MLVector3 *pV1, const MLVector3 *pV2) {
+	*pOut = Vec3_Cross(*pV1, *pV2);
+	return pOut;
+}
 
-MLVector3 *Vec3_Cross(MLVector3 *pOut, const MLVector3 *pV1, const MLVector3 *pV2);
+// row vector times matrix
+inline MLVector4 Vec4_Transform(const MLVector4 &v, const MLMatrix4 &m) {
+	MLVector4 res;
+#if defined(ML_SIMD_SSE2)
+	// unaligned loads, heap blocks on 32 bit targets are only 8 byte aligned
+	__m128 a = _mm_loadu_ps(&v.x);
+	__m128 r = _mm_mul_ps(_mm_shuffle_ps(a, a, 0x00), _mm_loadu_ps(m.m[0]));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0x55), _mm_loadu_ps(m.m[1])));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xaa), _mm_loadu_ps(m.m[2])));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xff), _mm_loadu_ps(m.m[3])));
+	_mm_storeu_ps(&res.x, r);
+#else
+	res.x = v.x * m._11 + v.y * m._21 + v.z * m._31 + v.w * m._41;
+	res.y = v.x * m._12 + v.y * m._22 + v.z * m._32 + v.w * m._42;
+	res.z = v.x * m._13 + v.y * m._23 + v.z * m._33 + v.w * m._43;
+	res.w = v.x * m._14 + v.y * m._24 + v.z * m._34 + v.w * m._44;
+#endif
+	return res;
+}
+// pOut may be pV
+inline MLVector4 *Vec4_Transform(MLVector4 *pOut, const MLVector4 *pV, const MLMatrix4 *pM) {
+	*pOut = Vec4_Transform(*pV, *pM);
+	return pOut;
+}
 
-MLVector4 *Vec4_Transform(MLVector4 *pOut, const MLVector4 *pV, const MLMatrix4 *pM);
+// batch transforms, pOut is resized to pIn's count and must not be pIn
+// (x, y, z, w) * M
+MLVector4Stream *Vec4_TransformStream(MLVector4Stream *pOut, const MLVector4Stream *pIn,
+	const MLMatrix4 *pM);
+// points, (x, y, z, 1) * M
+MLVector4Stream *Vec3_TransformCoordStream(MLVector4Stream *pOut, const MLVector3Stream *pIn,
+	const MLMatrix4 *pM);
+// directions, (x, y, z, 0) * M, pass the inverse transpose for normals
+MLVector3Stream *Vec3_TransformNormalStream(MLVector3Stream *pOut, const MLVector3Stream *pIn,
+	const MLMatrix4 *pM);
 
-MLMatrix4 *Matrix_Translation(MLMatrix4 *pOut, float x, float y, float z);
+// builders without trigonometry are constant expressions for constant arguments,
+// so fixed transforms can be built at compile time
+constexpr MLMatrix4 Matrix_Identity() {
+	return MLMatrix4(
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	);
+}
+
+constexpr MLMatrix4 Matrix_Translation(float x, float y, float z) {
+	return MLMatrix4(
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		x, y, z, 1
+	);
+}
+inline MLMatrix4 *Matrix_Translation(MLMatrix4 *pOut, float x, float y, float z) {
+	*pOut = Matrix_Translation(x, y, z);
+	return pOut;
+}
 
 MLMatrix4 *Matrix_RotationX(MLMatrix4 *pOut, float angle);
 
@@ -30,18 +120,64 @@ MLMatrix4 *Matrix_RotationY(MLMatrix4 *pOut, float angle);
 
 MLMatrix4 *Matrix_RotationZ(MLMatrix4 *pOut, float angle);
 
-MLMatrix4 *Matrix_Scaling(MLMatrix4 *pOut, float sx, float sy, float sz);
+constexpr MLMatrix4 Matrix_Scaling(float sx, float sy, float sz) {
+	return MLMatrix4(
+		sx, 0, 0, 0,
+		0, sy, 0, 0,
+		0, 0, sz, 0,
+		0, 0, 0, 1
+	);
+}
+inline MLMatrix4 *Matrix_Scaling(MLMatrix4 *pOut, float sx, float sy, float sz) {
+	*pOut = Matrix_Scaling(sx, sy, sz);
+	return pOut;
+}
 
-MLMatrix4 *Matrix_Transpose(MLMatrix4 *pOut, const MLMatrix4 *pM);
+inline MLMatrix4 Matrix_Transpose(const MLMatrix4 &m) {
+	return MLMatrix4(
+		m._11, m._21, m._31, m._41,
+		m._12, m._22, m._32, m._42,
+		m._13, m._23, m._33, m._43,
+		m._14, m._24, m._34, m._44
+	);
+}
+// pOut may be pM
+inline MLMatrix4 *Matrix_Transpose(MLMatrix4 *pOut, const MLMatrix4 *pM) {
+	*pOut = Matrix_Transpose(*pM);
+	return pOut;
+}
 
+// general inverse, pOut may be pM
 MLMatrix4 *Matrix_Inverse(MLMatrix4 *pOut, const MLMatrix4 *pM);
 
+// inverse of rotation, scale and translation only, last column must be (0, 0, 0, 1)
+MLMatrix4 *Matrix_InverseAffine(MLMatrix4 *pOut, const MLMatrix4 *pM);
+
+// inverse transpose of the upper 3x3, the rest is identity
+// normal matrix of an affine transformation
+MLMatrix4 *Matrix_InverseTranspose3x3(MLMatrix4 *pOut, const MLMatrix4 *pM);
+
 // calculate 3x3 cofactor
 float Cofactor3x3(const MLMatrix4 *pM, int row, int col);
 
 // param: plane and point
 // out: np + d
-float Plane_DotCoord(const MLPlane *pP, const MLVector3 *pV);
+inline float Plane_DotCoord(const MLPlane &p, const MLVector3 &v) {
+	return p.a * v.x + p.b * v.y + p.c * v.z + p.d;
+}
+inline float Plane_DotCoord(const MLPlane *pP, const MLVector3 *pV) {
+	return Plane_DotCoord(*pP, *pV);
+}
+
+// scale so the normal is unit length and np + d is the distance
+inline MLPlane Plane_Normalize(const MLPlane &p) {
+	float s = 1.0f / sqrtf(p.a * p.a + p.b * p.b + p.c * p.c);
+	return MLPlane(p.a * s, p.b * s, p.c * s, p.d * s);
+}
+inline MLPlane *Plane_Normalize(MLPlane *pOut, const MLPlane *pP) {
+	*pOut = Plane_Normalize(*pP);
+	return pOut;
+}
 
 // view matrix
 MLMatrix4 *Matrix_LookAt(MLMatrix4 *pOut, const MLVector3 *pEye, const MLVector3 *pAt,
@@ -51,5 +187,204 @@ MLMatrix4 *Matrix_LookAt(MLMatrix4 *pOut, const MLVector3 *pEye, const MLVector3
 MLMatrix4 *Matrix_PerspectiveFov(MLMatrix4 *pOut, float fovY, float Aspect, float zn, float zf);
 
 // viewport matrix
-MLMatrix4 *Matrix_Viewport(MLMatrix4 *pOut, float screenx, float screeny, int width, int height,
-	float minZ = 0.0f, float maxZ = 1.0f);
\ No newline at end of file
+constexpr MLMatrix4 Matrix_Viewport(float x, float y, int width, int height,
+	float minZ = 0.0f, float maxZ = 1.0f) {
+	return MLMatrix4(
+		width * 0.5f, 0, 0, 0,
+		0, -(height * 0.5f), 0, 0,
+		0, 0, maxZ - minZ, 0,
+		x + width * 0.5f, y + height * 0.5f, minZ, 1
+	);
+}
+inline MLMatrix4 *Matrix_Viewport(MLMatrix4 *pOut, float x, float y, int width, int height,
+	float minZ = 0.0f, float maxZ = 1.0f) {
+	*pOut = Matrix_Viewport(x, y, width, height, minZ, maxZ);
+	return pOut;
+}
+
+// quaternions, unit length ones are rotations
+inline float Quat_Dot(const MLQuaternion &q1, const MLQuaternion &q2) {
+	return q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
+}
+inline float Quat_Dot(const MLQuaternion *pQ1, const MLQuaternion *pQ2) {
+	return Quat_Dot(*pQ1, *pQ2);
+}
+
+// inverse rotation of a unit quaternion
+constexpr MLQuaternion Quat_Conjugate(const MLQuaternion &q) {
+	return MLQuaternion(-q.x, -q.y, -q.z, q.w);
+}
+inline MLQuaternion *Quat_Conjugate(MLQuaternion *pOut, const MLQuaternion *pQ) {
+	*pOut = Quat_Conjugate(*pQ);
+	return pOut;
+}
+
+inline MLQuaternion Quat_Normalize(const MLQuaternion &q) {
+	return q * (1.0f / sqrtf(Quat_Dot(q, q)));
+}
+inline MLQuaternion *Quat_Normalize(MLQuaternion *pOut, const MLQuaternion *pQ) {
+	*pOut = Quat_Normalize(*pQ);
+	return pOut;
+}
+
+// q1 followed by q2, same as q1 * q2
+inline MLQuaternion *Quat_Multiply(MLQuaternion *pOut, const MLQuaternion *pQ1,
+	const MLQuaternion *pQ2) {
+	*pOut = *pQ1 * *pQ2;
+	return pOut;
+}
+
+// rotation by angle around axis, the axis needn't be unit length
+MLQuaternion Quat_RotationAxis(const MLVector3 &axis, float angle);
+inline MLQuaternion *Quat_RotationAxis(MLQuaternion *pOut, const MLVector3 *pAxis, float angle) {
+	*pOut = Quat_RotationAxis(*pAxis, angle);
+	return pOut;
+}
+
+// rotation part of a matrix without scale
+MLQuaternion Quat_RotationMatrix(const MLMatrix4 &m);
+inline MLQuaternion *Quat_RotationMatrix(MLQuaternion *pOut, const MLMatrix4 *pM) {
+	*pOut = Quat_RotationMatrix(*pM);
+	return pOut;
+}
+
+MLMatrix4 Matrix_RotationQuaternion(const MLQuaternion &q);
+inline MLMatrix4 *Matrix_RotationQuaternion(MLMatrix4 *pOut, const MLQuaternion *pQ) {
+	*pOut = Matrix_RotationQuaternion(*pQ);
+	return pOut;
+}
+
+// spherical interpolation along the shorter arc, constant angular speed
+MLQuaternion Quat_Slerp(const MLQuaternion &q1, const MLQuaternion &q2, float t);
+inline MLQuaternion *Quat_Slerp(MLQuaternion *pOut, const MLQuaternion *pQ1,
+	const MLQuaternion *pQ2, float t) {
+	*pOut = Quat_Slerp(*pQ1, *pQ2, t);
+	return pOut;
+}
+
+// normalized linear interpolation along the shorter arc, no trigonometry but
+// the speed varies a little over wide angles
+inline MLQuaternion Quat_Nlerp(const MLQuaternion &q1, const MLQuaternion &q2, float t) {
+	float t2 = Quat_Dot(q1, q2) < 0.0f ? -t : t;
+	return Quat_Normalize(q1 * (1.0f - t) + q2 * t2);
+}
+inline MLQuaternion *Quat_Nlerp(MLQuaternion *pOut, const MLQuaternion *pQ1,
+	const MLQuaternion *pQ2, float t) {
+	*pOut = Quat_Nlerp(*pQ1, *pQ2, t);
+	return pOut;
+}
+
+// rotate a vector by a unit quaternion
+inline MLVector3 Vec3_Rotate(const MLVector3 &v, const MLQuaternion &q) {
+	MLVector3 u(q.x, q.y, q.z);
+	MLVector3 t = Vec3_Cross(u, v) * 2.0f;
+	return v + t * q.w + Vec3_Cross(u, t);
+}
+inline MLVector3 *Vec3_Rotate(MLVector3 *pOut, const MLVector3 *pV, const MLQuaternion *pQ) {
+	*pOut = Vec3_Rotate(*pV, *pQ);
+	return pOut;
+}
+
+// batch quaternions, pOut is resized to pQ1's count and may be an input
+// pQ2 must hold as many as pQ1
+MLQuaternionStream *Quat_MultiplyStream(MLQuaternionStream *pOut, const MLQuaternionStream *pQ1,
+	const MLQuaternionStream *pQ2);
+MLQuaternionStream *Quat_NormalizeStream(MLQuaternionStream *pOut, const MLQuaternionStream *pQ1);
+MLQuaternionStream *Quat_NlerpStream(MLQuaternionStream *pOut, const MLQuaternionStream *pQ1,
+	const MLQuaternionStream *pQ2, float t);
+
+// planes of the clip volume of m, in the space m transforms from
+// view * projection gives a world space frustum, world * view * projection an object space one
+MLFrustum Frustum_FromMatrix(const MLMatrix4 &m);
+inline MLFrustum *Frustum_FromMatrix(MLFrustum *pOut, const MLMatrix4 *pM) {
+	*pOut = Frustum_FromMatrix(*pM);
+	return pOut;
+}
+
+// out: ML_OUTSIDE, ML_INTERSECT or ML_INSIDE
+// conservative, a bound near a corner of the frustum may intersect without touching it
+int Frustum_ClassifySphere(const MLFrustum &f, const MLVector3 &center, float radius);
+int Frustum_ClassifyAABB(const MLFrustum &f, const MLVector3 &boxmin, const MLVector3 &boxmax);
+
+// classify count bounds per stream into pOut, the same as the single ones
+// spheres: center in x, y, z and radius in w
+unsigned char *Frustum_ClassifySphereStream(unsigned char *pOut, const MLFrustum *pF,
+	const MLVector4Stream *pSpheres);
+unsigned char *Frustum_ClassifyAABBStream(unsigned char *pOut, const MLFrustum *pF,
+	const MLVector3Stream *pMin, const MLVector3Stream *pMax);
+
+// affine transforms
+// drops the last column of m, which must be (0, 0, 0, 1)
+inline MLAffine3x4 Affine_FromMatrix(const MLMatrix4 &m) {
+	return MLAffine3x4(
+		m._11, m._21, m._31, m._41,
+		m._12, m._22, m._32, m._42,
+		m._13, m._23, m._33, m._43
+	);
+}
+inline MLAffine3x4 *Affine_FromMatrix(MLAffine3x4 *pOut, const MLMatrix4 *pM) {
+	*pOut = Affine_FromMatrix(*pM);
+	return pOut;
+}
+
+inline MLMatrix4 Matrix_FromAffine(const MLAffine3x4 &a) {
+	return MLMatrix4(
+		a.m[0][0], a.m[1][0], a.m[2][0], 0,
+		a.m[0][1], a.m[1][1], a.m[2][1], 0,
+		a.m[0][2], a.m[1][2], a.m[2][2], 0,
+		a.m[0][3], a.m[1][3], a.m[2][3], 1
+	);
+}
+inline MLMatrix4 *Matrix_FromAffine(MLMatrix4 *pOut, const MLAffine3x4 *pA) {
+	*pOut = Matrix_FromAffine(*pA);
+	return pOut;
+}
+
+// points, (x, y, z, 1) * A
+inline MLVector3 Vec3_TransformCoord(const MLVector3 &v, const MLAffine3x4 &a) {
+	return MLVector3(
+		v.x * a.m[0][0] + v.y * a.m[0][1] + v.z * a.m[0][2] + a.m[0][3],
+		v.x * a.m[1][0] + v.y * a.m[1][1] + v.z * a.m[1][2] + a.m[1][3],
+		v.x * a.m[2][0] + v.y * a.m[2][1] + v.z * a.m[2][2] + a.m[2][3]);
+}
+inline MLVector3 *Vec3_TransformCoord(MLVector3 *pOut, const MLVector3 *pV,
+	const MLAffine3x4 *pA) {
+	*pOut = Vec3_TransformCoord(*pV, *pA);
+	return pOut;
+}
+
+// directions, (x, y, z, 0) * A
+inline MLVector3 Vec3_TransformNormal(const MLVector3 &v, const MLAffine3x4 &a) {
+	return MLVector3(
+		v.x * a.m[0][0] + v.y * a.m[0][1] + v.z * a.m[0][2],
+		v.x * a.m[1][0] + v.y * a.m[1][1] + v.z * a.m[1][2],
+		v.x * a.m[2][0] + v.y * a.m[2][1] + v.z * a.m[2][2]);
+}
+inline MLVector3 *Vec3_TransformNormal(MLVector3 *pOut, const MLVector3 *pV,
+	const MLAffine3x4 *pA) {
+	*pOut = Vec3_TransformNormal(*pV, *pA);
+	return pOut;
+}
+
+// a followed by a full transform such as a projection, 48 multiplies instead of 64
+MLMatrix4 operator * (const MLAffine3x4 &lhs, const MLMatrix4 &rhs);
+
+// singular a gives infinities
+inline MLAffine3x4 Affine_Inverse(const MLAffine3x4 &a) {
+	MLMatrix4 m = Matrix_FromAffine(a);
+	return Affine_FromMatrix(*Matrix_InverseAffine(&m, &m));
+}
+inline MLAffine3x4 *Affine_Inverse(MLAffine3x4 *pOut, const MLAffine3x4 *pA) {
+	*pOut = Affine_Inverse(*pA);
+	return pOut;
+}
+
+// normal matrix of a, as an MLMatrix4 for Vec3_TransformNormalStream
+inline MLMatrix4 *Matrix_InverseTranspose3x3(MLMatrix4 *pOut, const MLAffine3x4 *pA) {
+	MLMatrix4 m = Matrix_FromAffine(*pA);
+	return Matrix_InverseTranspose3x3(pOut, &m);
+}
+
+// batch (x, y, z, w) * A, w is copied, pOut is resized to pIn's count and must not be pIn
+MLVector4Stream *Vec4_TransformStream(MLVector4Stream *pOut, const MLVector4Stream *pIn,
+	const MLAffine3x4 *pA);
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include "MLScalar.h"
 struct MLVector {
 	float x, y, z;
 };
@@ -7,39 +8,54 @@ class MLVector3 : public MLVector {
 public:
 	// constructors
 	MLVector3() {};
-	MLVector3(float x, float y, float z) {
-		this->x = x;
-		this->y = y;
-		this->z = z;
-	}
+	constexpr MLVector3(float x, float y, float z) : MLVector{ x, y, z } {}
 	// unary operators
-	MLVector3 operator - () const;
+	constexpr MLVector3 operator - () const {
+		return MLVector3(-x, -y, -z);
+	}
 	// binary operators
-	MLVector3 operator + (const MLVector3&) const;
-	MLVector3 operator - (const MLVector3&) const;
-	MLVector3 operator * (float) const;
-	MLVector3 operator / (float) const;
+	constexpr MLVector3 operator + (const MLVector3 &rhs) const {
+		return MLVector3(x + rhs.x, y + rhs.y, z + rhs.z);
+	}
+	constexpr MLVector3 operator - (const MLVector3 &rhs) const {
+		return *this + (-rhs);
+	}
+	constexpr MLVector3 operator * (float rhs) const {
+		return MLVector3(x * rhs, y * rhs, z * rhs);
+	}
+	constexpr MLVector3 operator / (float rhs) const {
+		return *this * (1.0f / rhs);
+	}
 
-	bool operator == (const MLVector3&) const;
-	bool operator != (const MLVector3&) const;
+	bool operator == (const MLVector3 &rhs) const {
+		if (this == &rhs)
+			return true;
+		return Float_Equals(x, rhs.x) && Float_Equals(y, rhs.y) && Float_Equals(z, rhs.z);
+	}
+	bool operator != (const MLVector3 &rhs) const {
+		return !(*this == rhs);
+	}
 };
 
-class MLVector4 {
+class alignas(16) MLVector4 {
 public:
 	// members
 	float x, y, z, w;
 	// constructors
 	MLVector4() {};
-	MLVector4(float x, float y, float z, float w) {
-		this->x = x;
-		this->y = y;
-		this->z = z;
-		this->w = w;
-	}
+	constexpr MLVector4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
 	// binary operators
-	MLVector4 operator * (float) const;
-	MLVector4 operator / (float) const;
+	constexpr MLVector4 operator * (float rhs) const {
+		return MLVector4(x * rhs, y * rhs, z * rhs, w * rhs);
+	}
+	constexpr MLVector4 operator / (float rhs) const {
+		return *this * (1.0f / rhs);
+	}
 	// assignment operators
-	MLVector4& operator *= (float);
-	MLVector4& operator /= (float);
-};
\ No newline at end of file
+	MLVector4& operator *= (float rhs) {
+		return *this = *this * rhs;
+	}
+	MLVector4& operator /= (float rhs) {
+		return *this *= 1.0f / rhs;
+	}
+};
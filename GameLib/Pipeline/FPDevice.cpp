@@ -0,0 +1,1279 @@
+/****************************************************
+* Fix Pipeline implementation, just a demo
+* Reference: 
+* https://github.com/skywind3000/mini3d
+* https://github.com/zhangbaochong/Tiny3D
+*/ 
+
+#include "FPDevice.h"
+#include "../Math/MLSimd.h"
+#include <string.h>
+#include <float.h>
+
+using std::min;
+using std::max;
+
+Device::Device(FPRenderTarget *rt) {
+	_rt = rt;
+	_width = rt->GetWidth();
+	_height = rt->GetHeight();
+	_pitch = rt->GetPitch();
+	_backbuf = rt->GetColorBuffer();
+	// whole hiz squares and cache line aligned rows, so a square row is one aligned load
+	_hizpitch = (_width + FP_HIZSIZE - 1) / FP_HIZSIZE;
+	int hizrows = (_height + FP_HIZSIZE - 1) / FP_HIZSIZE;
+	const int linefloats = (int)(FP_CACHELINE / sizeof(float));
+	_zpitch = (_hizpitch * FP_HIZSIZE + linefloats - 1) / linefloats * linefloats;
+	_zbuf = (float *)FPAlignedAlloc(sizeof(float) * _zpitch * hizrows * FP_HIZSIZE);
+	_hiz = new float[_hizpitch * hizrows];
+	_hizdirty = new unsigned char[_hizpitch * hizrows];
+	_raster = RASTER_SCANLINE;
+	_kernels = nullptr;
+	_perspective = PERSPECTIVE_EXACT;
+	_perspectiveerror = 0.25f;
+	_interpolate = INTERPOLATE_SPAN;
+	_bin = BIN_NONE;
+	_pool = nullptr;
+	_workers = 0;
+	_tilesx = (_width + FP_TILESIZE - 1) / FP_TILESIZE;
+	_tilesy = (_height + FP_TILESIZE - 1) / FP_TILESIZE;
+	_viewport = Matrix_Viewport(0.0f, 0.0f, _width, _height);
+	_wvdirty = true;
+	_bounded = false;
+	_ludirty = true;
+	_texres = nullptr;
+	_tex = nullptr;
+	_LOD = 0;
+	_clear = CLEAR_IMMEDIATE;
+	_tileclear = new unsigned char[_tilesx * _tilesy];
+	memset(_tileclear, 0, _tilesx * _tilesy);
+	_arenas.push_back(new FPArena);
+	_arenapeak = 0;
+	_tris = nullptr;
+	_tricount = 0;
+	_tricapacity = 0;
+	_tv = nullptr;
+	_tvfirst = 0;
+}
+
+Device::~Device() {
+	// join the workers before anything they draw with goes away
+	delete _pool;
+	for (size_t i = 0; i < _arenas.size(); i++)
+		delete _arenas[i];
+	if (_texres)
+		_texres->Release();
+	FPAlignedFree(_zbuf);
+	delete[] _hiz;
+	delete[] _hizdirty;
+	delete[] _tileclear;
+}
+
+void Device::SetTransform(TRANSFORMTYPE type, const MLMatrix4 *m) {
+	switch (type) {
+	case TRANSFORM_WORLD:
+	case TRANSFORM_VIEW: {
+		MLAffine3x4 a = Affine_FromMatrix(*m);
+		SetTransform(type, &a);
+		break;
+	}
+	case TRANSFORM_PROJECTION:
+		_proj = *m;
+		_wvdirty = true;
+		break;
+	}
+}
+
+void Device::SetTransform(TRANSFORMTYPE type, const MLAffine3x4 *m) {
+	switch (type) {
+	case TRANSFORM_WORLD:
+		_world = *m;
+		_wvdirty = true;
+		break;
+	case TRANSFORM_VIEW:
+		_view = *m;
+		_wvdirty = true;
+		_ludirty = true;
+		break;
+	case TRANSFORM_PROJECTION:
+		_proj = Matrix_FromAffine(*m);
+		_wvdirty = true;
+		break;
+	}
+}
+
+void Device::SetRenderState(FILLTYPE value) {
+	_rstate = value;
+}
+
+void Device::SetShadeMode(SHADETYPE value) {
+	_shade = value;
+}
+
+void Device::SetSampleState(SAMPLETYPE value) {
+	_sample = value;
+}
+
+void Device::SetRasterMode(RASTERTYPE value) {
+	_raster = value;
+}
+
+void Device::SetPerspectiveMode(PERSPECTIVETYPE value) {
+	_perspective = value;
+}
+
+void Device::SetPerspectiveError(float error) {
+	_perspectiveerror = error;
+}
+
+void Device::SetInterpolateMode(INTERPOLATETYPE value) {
+	_interpolate = value;
+}
+
+void Device::SetBinMode(BINTYPE value) {
+	_bin = value;
+}
+
+void Device::SetWorkerCount(int count) {
+	_workers = count;
+	delete _pool;
+	_pool = nullptr;
+}
+
+void Device::SetClearMode(CLEARTYPE value) {
+	_clear = value;
+}
+
+void Device::Clear(unsigned int color, float z) {
+	// hiz is already right for a pending depth clear, so rejection needs no resolve
+	int hizrows = (_height + FP_HIZSIZE - 1) / FP_HIZSIZE;
+	FPFill32(_hiz, z, _hizpitch * hizrows);
+	memset(_hizdirty, 0, _hizpitch * hizrows);
+	if (_clear == CLEAR_DEFERRED) {
+		_clearcolor = color;
+		_clearz = z;
+		memset(_tileclear, FP_CLEARCOLOR | FP_CLEARDEPTH, _tilesx * _tilesy);
+		return;
+	}
+	memset(_tileclear, 0, _tilesx * _tilesy);
+	FPFill32(_backbuf, color, _pitch * _height);
+	// padding too, it then never raises a square's farthest depth
+	FPFill32(_zbuf, z, _zpitch * hizrows * FP_HIZSIZE);
+}
+
+void Device::SetStreamSource(FPVertex *vb) {
+	_vb = vb;
+}
+
+void Device::SetIndices(int *ib) {
+	_ib = ib;
+}
+
+void Device::SetBounds(const MLVector3 *pMin, const MLVector3 *pMax) {
+	_bounded = pMin && pMax;
+	if (_bounded) {
+		_boundmin = *pMin;
+		_boundmax = *pMax;
+	}
+}
+
+bool Device::BoundsVisible(const MLVector3 *pMin, const MLVector3 *pMax) {
+	UpdateTransforms();
+	return Frustum_ClassifyAABB(_frustum, *pMin, *pMax) != ML_OUTSIDE;
+}
+
+void Device::SetMaterial(Material *mtrl) {
+	_mtrl = new Material(*mtrl);
+	_ludirty = true;
+}
+
+void Device::SetLight(Light *light) {
+	_light = new Light(*light);
+	_ludirty = true;
+}
+
+void Device::SetTexture(FPTextureResource *tex) {
+	if (tex) {
+		tex->AddRef();
+		tex->Wait();
+	}
+	if (_texres)
+		_texres->Release();
+	_texres = tex;
+	_tex = tex ? tex->GetLevels() : nullptr;
+	_LOD = tex ? tex->GetLevelCount() : 0;
+}
+
+void Device::SetTexture(const Texture *tex) {
+	FPTextureResource *res = FPTextureResource::Create(*tex);
+	SetTexture(res);
+	res->Release();
+}
+
+void Device::LightEnable(bool value) {
+	_lightenable = value;
+}
+
+// bake light and material into _lu in view space, skipped while clean
+void Device::UpdateLightUniforms() {
+	if (!_ludirty)
+		return;
+	_ludirty = false;
+	FPLightUniforms &lu = _lu;
+	lu.type = _light->Type;
+	const MLVector3 &dir = _light->Direction, &pos = _light->Position;
+	lu.direction = Vec3_Normalize(Vec3_TransformNormal(dir, _view));
+	lu.tolight = -lu.direction;
+	lu.position = Vec3_TransformCoord(pos, _view);
+	lu.range = _light->Range;
+	lu.attenuation0 = _light->Attenuation0;
+	lu.attenuation1 = _light->Attenuation1;
+	lu.attenuation2 = _light->Attenuation2;
+	lu.costheta = cosf(_light->Theta * 0.5f);
+	lu.cosphi = cosf(_light->Phi * 0.5f);
+	lu.falloff = _light->Falloff;
+	lu.emissiveambient = _mtrl->Emissive + _mtrl->Ambient * _light->Ambient;
+	lu.diffuse = _mtrl->Diffuse * _light->Diffiuse;
+	lu.specular = _mtrl->Specular * _light->Specular;
+	lu.power = _mtrl->Power;
+}
+
+Color Device::GetDiffuseColor(const MLVector3 *normal, const MLVector3 *lightdir) {
+	float cosine = max(0.0f, Vec3_Dot(normal, lightdir));
+	Color diffuse = _lu.diffuse * cosine;
+	return diffuse;
+}
+
+Color Device::GetSpecularColor(const MLVector3 *normal, const MLVector3 *lightdir,
+	const MLVector4 *pV) {
+	Color specular(0.0f, 0.0f, 0.0f);
+	if (Vec3_Dot(normal, lightdir) <= 0)
+		return specular;
+	MLVector3 view = -Vec3_Normalize(MLVector3(pV->x, pV->y, pV->z));
+	MLVector3 half = Vec3_Normalize(view + *lightdir);
+	float cosine = max(0.0f, Vec3_Dot(*normal, half));
+	specular = _lu.specular * powf(cosine, _lu.power);
+	return specular;
+}
+
+// get the final light color(emissive + amibent + diffuse + specular)
+// parameter: transformed normal and transformed vertex
+Color Device::GetLightColor(const MLVector4 *pN, const MLVector4 *pV) {
+	const FPLightUniforms &lu = _lu;
+	// light direction, distance attenuation and spot cone
+	MLVector3 lightdir = lu.tolight;
+	float attenuation = 1.0f;
+	float spotfactor = 1.0f;
+	if (lu.type == LIGHT_POINT || lu.type == LIGHT_SPOT) {
+		MLVector3 dir(lu.position.x - pV->x, lu.position.y - pV->y, lu.position.z - pV->z);
+		float dis = Vec3_Length(dir);
+		if (dis > lu.range)
+			return lu.emissiveambient;
+		lightdir = dir / dis;
+		attenuation = 1.0f / (lu.attenuation0 + lu.attenuation1 * dis + lu.attenuation2 * dis * dis);
+		if (lu.type == LIGHT_SPOT) {
+			float cosine = -Vec3_Dot(lu.direction, lightdir);
+			if (cosine <= lu.cosphi)
+				return lu.emissiveambient;
+			if (cosine <= lu.costheta)
+				spotfactor = powf((cosine - lu.cosphi) / (lu.costheta - lu.cosphi), lu.falloff);
+		}
+	}
+	if (Float_Equals(attenuation, 0.0f) || Float_Equals(spotfactor, 0.0f))
+		return lu.emissiveambient;
+	MLVector3 normal = Vec3_Normalize(MLVector3(pN->x, pN->y, pN->z));
+	Color diffuse = GetDiffuseColor(&normal, &lightdir);
+	Color specular = GetSpecularColor(&normal, &lightdir, pV);
+	float factor = attenuation * spotfactor;
+	return lu.emissiveambient + (diffuse + specular) * factor;
+}
+
+Color Device::BilinearTextureSampling(const Texture *tex, float u, float v) {
+	// interpolated uv can overshoot [0, 1] slightly at triangle edges
+	u = max(0.0f, min(u, 1.0f));
+	v = max(0.0f, min(v, 1.0f));
+	float x = (tex->_width - 1) * u;
+	float y = (tex->_height - 1) * v;
+	int x0 = (int)x, y0 = (int)y;
+	int x1 = min(x0 + 1, tex->_width - 1);
+	int y1 = min(y0 + 1, tex->_height - 1);
+	float du = x - x0;
+	float dv = y - y0;
+	// the four texels share a tile unless x0 or y0 is on a tile edge
+	Color top = tex->GetTexel(x0, y0) * (1.0f - du) + tex->GetTexel(x1, y0) * du;
+	Color bottom = tex->GetTexel(x0, y1) * (1.0f - du) + tex->GetTexel(x1, y1) * du;
+	return top * (1.0f - dv) + bottom * dv;
+}
+
+float Device::GenerateMipMapRatio(const MLVector4 *p1, const MLVector4 *p2,
+	const MLVector4 *p3) {
+	float triarea = (p1->y - p3->y) * (p2->x - p3->x) + (p2->y - p3->y) * (p3->x - p1->x);
+	float texarea = 1.0f * _tex[0]._width * _tex[0]._height;
+	float ratio = fabsf(texarea / triarea);
+	return log2f(ratio) * 0.5f;
+}
+
+// clip
+// planes of the screen, a triangle outside one of them with every vertex is rejected
+const int FP_CLIPLEFT = 1;
+const int FP_CLIPRIGHT = 2;
+const int FP_CLIPBOTTOM = 4;
+const int FP_CLIPTOP = 8;
+// planes triangles are really cut at, in the order they are clipped against
+const int FP_CLIPNEAR = 16;
+const int FP_CLIPFAR = 32;
+const int FP_CLIPGUARDLEFT = 64;
+const int FP_CLIPGUARDRIGHT = 128;
+const int FP_CLIPGUARDBOTTOM = 256;
+const int FP_CLIPGUARDTOP = 512;
+const int FP_CLIPPLANES = ~(FP_CLIPLEFT | FP_CLIPRIGHT | FP_CLIPBOTTOM | FP_CLIPTOP);
+// x and y are only cut outside [-FP_GUARDBAND * w, FP_GUARDBAND * w], the rest of a triangle
+// off the screen is left to the raster rect. Keeps screen positions small enough for the
+// fixed point setup while almost no triangle needs cutting at the sides
+const float FP_GUARDBAND = 8.0f;
+// every clip plane adds at most one vertex to the convex polygon
+const int FP_MAXCLIPVERTS = 9;
+const int FP_MAXCLIPTRIS = FP_MAXCLIPVERTS - 2;
+
+// signed distance of v to a clip plane, inside when >= 0
+static float ClipDistance(const MLVector4 *v, int plane) {
+	switch (plane) {
+	case FP_CLIPNEAR: return v->z;
+	case FP_CLIPFAR: return v->w - v->z;
+	case FP_CLIPGUARDLEFT: return v->x + FP_GUARDBAND * v->w;
+	case FP_CLIPGUARDRIGHT: return FP_GUARDBAND * v->w - v->x;
+	case FP_CLIPGUARDBOTTOM: return v->y + FP_GUARDBAND * v->w;
+	default: return FP_GUARDBAND * v->w - v->y;
+	}
+}
+
+// after projection(in CVV)
+int Device::ClipCode(const MLVector4 *v) {
+	int code = 0;
+	if (v->x < -v->w)
+		code |= v->x < -FP_GUARDBAND * v->w ? FP_CLIPLEFT | FP_CLIPGUARDLEFT : FP_CLIPLEFT;
+	if (v->x > v->w)
+		code |= v->x > FP_GUARDBAND * v->w ? FP_CLIPRIGHT | FP_CLIPGUARDRIGHT : FP_CLIPRIGHT;
+	if (v->y < -v->w)
+		code |= v->y < -FP_GUARDBAND * v->w ? FP_CLIPBOTTOM | FP_CLIPGUARDBOTTOM : FP_CLIPBOTTOM;
+	if (v->y > v->w)
+		code |= v->y > FP_GUARDBAND * v->w ? FP_CLIPTOP | FP_CLIPGUARDTOP : FP_CLIPTOP;
+	if (v->z < 0.0f)
+		code |= FP_CLIPNEAR;
+	if (v->z > v->w)
+		code |= FP_CLIPFAR;
+	return code;
+}
+
+void Device::ClipVertexInterpolation(FPClipVertex *vOut, const FPClipVertex *v1,
+	const FPClipVertex *v2, float factor) {
+	const FPTransformedVertex &t1 = v1->t, &t2 = v2->t;
+	FPTransformedVertex &t = vOut->t;
+	t.clip.x = LinearInterpolation(t1.clip.x, t2.clip.x, factor);
+	t.clip.y = LinearInterpolation(t1.clip.y, t2.clip.y, factor);
+	t.clip.z = LinearInterpolation(t1.clip.z, t2.clip.z, factor);
+	t.clip.w = LinearInterpolation(t1.clip.w, t2.clip.w, factor);
+	vOut->r = LinearInterpolation(v1->r, v2->r, factor);
+	vOut->g = LinearInterpolation(v1->g, v2->g, factor);
+	vOut->b = LinearInterpolation(v1->b, v2->b, factor);
+	vOut->u = LinearInterpolation(v1->u, v2->u, factor);
+	vOut->v = LinearInterpolation(v1->v, v2->v, factor);
+	// the rest is only written by ProcessVertices with lighting
+	if (!_lightenable)
+		return;
+	t.view.x = LinearInterpolation(t1.view.x, t2.view.x, factor);
+	t.view.y = LinearInterpolation(t1.view.y, t2.view.y, factor);
+	t.view.z = LinearInterpolation(t1.view.z, t2.view.z, factor);
+	t.view.w = LinearInterpolation(t1.view.w, t2.view.w, factor);
+	t.normal.x = LinearInterpolation(t1.normal.x, t2.normal.x, factor);
+	t.normal.y = LinearInterpolation(t1.normal.y, t2.normal.y, factor);
+	t.normal.z = LinearInterpolation(t1.normal.z, t2.normal.z, factor);
+	t.normal.w = 0.0f;
+	if (_shade == SHADE_GOURAUD) {
+		t.lightcolor._r = LinearInterpolation(t1.lightcolor._r, t2.lightcolor._r, factor);
+		t.lightcolor._g = LinearInterpolation(t1.lightcolor._g, t2.lightcolor._g, factor);
+		t.lightcolor._b = LinearInterpolation(t1.lightcolor._b, t2.lightcolor._b, factor);
+	}
+}
+
+// backface culling
+// after projection division
+bool Device::Backface_Culling(const MLVector4 *p1, const MLVector4 *p2, const MLVector4 *p3) {
+	// wireframe mode don't need backface culling
+	if (_rstate == FILL_WIREFRAME)
+		return true;
+	// BE CARE OF FLOATING POINT ERROR!!!
+	return (p1->y - p3->y) * (p2->x - p3->x) + (p2->y - p3->y) * (p3->x - p1->x) > EPSILON;
+}
+
+void Device::BresenhamDrawLine(const MLVector4 *p1, const MLVector4 *p2, FPRasterContext *ctx) {
+	int x1 = (int)p1->x, y1 = (int)p1->y, x2 = (int)p2->x, y2 = (int)p2->y;
+	int dx = x2 - x1, dy = y2 - y1;
+	int xstep = 1, ystep = 1;
+	if (x1 > x2) {
+		dx = -dx;
+		xstep = -1;
+	}
+	if (y1 > y2) {
+		dy = -dy;
+		ystep = -1;
+	}
+	// if line is a point
+	if (dx == 0 && dy == 0) {
+		SetBackBuffer(x1, y1, 0x00000000, &ctx->clip);
+		return;
+	}
+	// if line slope infinity
+	if (dx == 0) {
+		for (int y = y1; y != y2; y += ystep)
+			SetBackBuffer(x1, y, 0x00000000, &ctx->clip);
+		return;
+	}
+	// if line slope 0
+	if (dy == 0) {
+		for (int x = x1; x != x2; x += xstep)
+			SetBackBuffer(x, y1, 0x00000000, &ctx->clip);
+		return;
+	}
+	int dx2 = 2 * dx, dy2 = 2 * dy;
+	// set x unit, step y
+	if (dx > dy) {
+		int error = dx - dy2;
+		for (int x = x1, y = y1; x != x2; x += xstep) {
+			SetBackBuffer(x, y, 0x00000000, &ctx->clip);
+			if (error < 0) {
+				error += dx2;
+				y += ystep;
+			}
+			error -= dy2;
+		}
+	}
+	// set y unit, step x
+	else {
+		int error = dy - dx2;
+		for (int y = y1, x = x1; y != y2; y += ystep) {
+			SetBackBuffer(x, y, 0x00000000, &ctx->clip);
+			if (error < 0) {
+				error += dy2;
+				x += xstep;
+			}
+			error -= dx2;
+		}
+	}
+}
+
+void Device::DrawScanLine(const FPVertex *left, const FPVertex *right, int start, int end,
+	int yIndex, FPRasterContext *ctx) {
+	FPVertex *step = ctx->arena->New<FPVertex>();
+	VertexDivision(step, left, right, right->_x - left->_x);
+	// every pixel is evaluated from the span start rather than accumulated, so the
+	// result doesn't depend on where the span is clipped
+	int first = max(start, ctx->clip.x0);
+	int last = min(end, ctx->clip.x1);
+	int count = _kernels->count;
+	// left is where the edge crosses the row, move it to the first pixel
+	float prestep = start - left->_x;
+	FPSpanInterp span;
+	span.z = left->_z + step->_z * prestep;
+	span.dz = step->_z;
+	span.zorigin = start;
+	span.w = left->_w + step->_w * prestep;
+	span.dw = step->_w;
+	span.origin = start;
+	_kernels->pack(span.a, left);
+	_kernels->pack(span.da, step);
+	for (int i = 0; i < count; i++)
+		span.a[i] += span.da[i] * prestep;
+	// PERSPECTIVE_SPAN*: pieces start at multiples of their length on screen, so they are
+	// whole hiz squares and the same wherever the span is clipped
+	int piece = 0;
+	if (_perspective == PERSPECTIVE_SPAN8)
+		piece = 8;
+	else if (_perspective == PERSPECTIVE_SPAN16)
+		piece = 16;
+	// attributes divided by w at both ends of the current piece
+	float ends[2][FP_MAXINTERP];
+	float *end0 = ends[0], *end1 = ends[1];
+	FPSpanInterp pieceinterp;
+	pieceinterp.z = span.z;
+	pieceinterp.dz = span.dz;
+	pieceinterp.zorigin = span.zorigin;
+	int x0 = 0, x1 = 0;
+	bool linear = false;
+	float ratio = 0.0f;
+	if (piece) {
+		// 1 / w is linear along the span, so over a piece where it goes from q to k * q an
+		// attribute interpolated linearly is off by at most (sqrt(k) - 1) / (sqrt(k) + 1) of
+		// its change, which is that many pieces on screen
+		float error = _perspectiveerror / piece;
+		float sqrtk = error < 1.0f ? (1.0f + error) / (1.0f - error) : FLT_MAX;
+		ratio = sqrtk * sqrtk;
+	}
+	// walk the span one hiz square at a time and skip squares that are hidden
+	for (int chunk = first; chunk < last;) {
+		int chunkend = min((chunk / FP_HIZSIZE + 1) * FP_HIZSIZE, last);
+		// z is linear along the span, so the nearest one is at an end
+		float z0 = span.z + span.dz * (float)(chunk - start);
+		float z1 = span.z + span.dz * (float)(chunkend - 1 - start);
+		if (min(z0, z1) >= GetHiZ(chunk / FP_HIZSIZE, yIndex / FP_HIZSIZE)) {
+			chunk = chunkend;
+			continue;
+		}
+		if (!piece) {
+			(this->*_kernels->span)(&span, chunk, chunkend, yIndex, ctx);
+			chunk = chunkend;
+			continue;
+		}
+		for (int xIndex = chunk; xIndex < chunkend;) {
+			if (xIndex >= x1) {
+				// the end of the last piece is the start of this one, unless squares between
+				// were skipped
+				bool reuse = linear && xIndex == x1;
+				x0 = xIndex;
+				x1 = min((xIndex / piece + 1) * piece, last);
+				// the end is at most one pixel past the span, 1 / w is still about right
+				float n0 = (float)(x0 - start), n1 = (float)(x1 - start);
+				float w0 = span.w + span.dw * n0, w1 = span.w + span.dw * n1;
+				linear = x1 - x0 > 1 && min(w0, w1) > 0.0f && max(w0, w1) <= ratio * min(w0, w1);
+				if (linear) {
+					if (reuse)
+						std::swap(end0, end1);
+					else {
+						float oneoverw0 = 1.0f / w0;
+						for (int i = 0; i < count; i++)
+							end0[i] = (span.a[i] + span.da[i] * n0) * oneoverw0;
+					}
+					float oneoverw1 = 1.0f / w1;
+					float oneoverlength = 1.0f / (x1 - x0);
+					for (int i = 0; i < count; i++) {
+						end1[i] = (span.a[i] + span.da[i] * n1) * oneoverw1;
+						pieceinterp.a[i] = end0[i];
+						pieceinterp.da[i] = (end1[i] - end0[i]) * oneoverlength;
+					}
+					pieceinterp.origin = x0;
+				}
+			}
+			int pieceend = min(x1, chunkend);
+			if (linear)
+				(this->*_kernels->spanlinear)(&pieceinterp, xIndex, pieceend, yIndex, ctx);
+			else
+				(this->*_kernels->span)(&span, xIndex, pieceend, yIndex, ctx);
+			xIndex = pieceend;
+		}
+		chunk = chunkend;
+	}
+}
+
+void Device::DrawBarycentricScanLine(int start, int end, int yIndex, FPRasterContext *ctx) {
+	const FPBaryInterp *bary = ctx->bary;
+	int first = max(start, ctx->clip.x0);
+	int last = min(end, ctx->clip.x1);
+	float zrow = bary->z + bary->dzdy * (yIndex - bary->y0);
+	for (int chunk = first; chunk < last;) {
+		int chunkend = min((chunk / FP_HIZSIZE + 1) * FP_HIZSIZE, last);
+		float z0 = zrow + bary->dzdx * (chunk - bary->x0);
+		float z1 = zrow + bary->dzdx * (chunkend - 1 - bary->x0);
+		if (min(z0, z1) < GetHiZ(chunk / FP_HIZSIZE, yIndex / FP_HIZSIZE))
+			(this->*_kernels->spanbary)(bary, chunk, chunkend, yIndex, ctx);
+		chunk = chunkend;
+	}
+}
+
+void Device::SetupBarycentric(const FPTriangle *tri, FPBaryInterp *bary) {
+	const FPVertex *v1 = &tri->v[0], *v2 = &tri->v[1], *v3 = &tri->v[2];
+	float dx1 = v2->_x - v1->_x, dy1 = v2->_y - v1->_y;
+	float dx2 = v3->_x - v1->_x, dy2 = v3->_y - v1->_y;
+	float area = dx1 * dy2 - dx2 * dy1;
+	float oneoverarea = Float_Equals(area, 0.0f) ? 0.0f : 1.0f / area;
+	bary->x0 = v1->_x;
+	bary->y0 = v1->_y;
+	// a value that changes by da1, da2 along the two edges leaving v1, as in VertexGradient
+	float da1 = v2->_z - v1->_z, da2 = v3->_z - v1->_z;
+	bary->z = v1->_z;
+	bary->dzdx = (da1 * dy2 - da2 * dy1) * oneoverarea;
+	bary->dzdy = (da2 * dx1 - da1 * dx2) * oneoverarea;
+	da1 = v2->_w - v1->_w;
+	da2 = v3->_w - v1->_w;
+	bary->w = v1->_w;
+	bary->dwdx = (da1 * dy2 - da2 * dy1) * oneoverarea;
+	bary->dwdy = (da2 * dx1 - da1 * dx2) * oneoverarea;
+	// b1 is v2->_w at v2 and 0 at the others, b2 the same for v3
+	bary->b1 = 0.0f;
+	bary->db1dx = v2->_w * dy2 * oneoverarea;
+	bary->db1dy = -v2->_w * dx2 * oneoverarea;
+	bary->b2 = 0.0f;
+	bary->db2dx = -v3->_w * dy1 * oneoverarea;
+	bary->db2dy = v3->_w * dx1 * oneoverarea;
+	// attributes in the vertices are divided by w
+	float a2[FP_MAXINTERP], a3[FP_MAXINTERP];
+	_kernels->pack(bary->a, v1);
+	_kernels->pack(a2, v2);
+	_kernels->pack(a3, v3);
+	float w1 = 1.0f / v1->_w, w2 = 1.0f / v2->_w, w3 = 1.0f / v3->_w;
+	for (int i = 0; i < _kernels->count; i++) {
+		bary->a[i] *= w1;
+		bary->da1[i] = a2[i] * w2 - bary->a[i];
+		bary->da2[i] = a3[i] * w3 - bary->a[i];
+	}
+}
+
+void Device::VertexInterpolation(FPVertex *vOut, const FPVertex *v1, const FPVertex *v2,
+	float factor) {
+	vOut->_x = LinearInterpolation(v1->_x, v2->_x, factor);
+	vOut->_y = LinearInterpolation(v1->_y, v2->_y, factor);
+	vOut->_z = LinearInterpolation(v1->_z, v2->_z, factor);
+	vOut->_w = LinearInterpolation(v1->_w, v2->_w, factor);
+	vOut->_r = LinearInterpolation(v1->_r, v2->_r, factor);
+	vOut->_g = LinearInterpolation(v1->_g, v2->_g, factor);
+	vOut->_b = LinearInterpolation(v1->_b, v2->_b, factor);
+	vOut->_nx = LinearInterpolation(v1->_nx, v2->_nx, factor);
+	vOut->_ny = LinearInterpolation(v1->_ny, v2->_ny, factor);
+	vOut->_nz = LinearInterpolation(v1->_nz, v2->_nz, factor);
+	vOut->_u = LinearInterpolation(v1->_u, v2->_u, factor);
+	vOut->_v = LinearInterpolation(v1->_v, v2->_v, factor);
+	vOut->_lightcolor._r = LinearInterpolation(v1->_lightcolor._r, v2->_lightcolor._r, factor);
+	vOut->_lightcolor._g = LinearInterpolation(v1->_lightcolor._g, v2->_lightcolor._g, factor);
+	vOut->_lightcolor._b = LinearInterpolation(v1->_lightcolor._b, v2->_lightcolor._b, factor);
+	vOut->_vpos.x = LinearInterpolation(v1->_vpos.x, v2->_vpos.x, factor);
+	vOut->_vpos.y = LinearInterpolation(v1->_vpos.y, v2->_vpos.y, factor);
+	vOut->_vpos.z = LinearInterpolation(v1->_vpos.z, v2->_vpos.z, factor);
+}
+
+void Device::VertexDivision(FPVertex *vOut, const FPVertex *v1, const FPVertex *v2,
+	float factor) {
+	float oneoverfactor = Float_Equals(factor, 0.0f) ? 0.0f : 1.0f / factor;
+	vOut->_x = (v2->_x - v1->_x) * oneoverfactor;
+	vOut->_y = (v2->_y - v1->_y) * oneoverfactor;
+	vOut->_z = (v2->_z - v1->_z) * oneoverfactor;
+	vOut->_w = (v2->_w - v1->_w) * oneoverfactor;
+	vOut->_r = (v2->_r - v1->_r) * oneoverfactor;
+	vOut->_g = (v2->_g - v1->_g) * oneoverfactor;
+	vOut->_b = (v2->_b - v1->_b) * oneoverfactor;
+	vOut->_nx = (v2->_nx - v1->_nx) * oneoverfactor;
+	vOut->_ny = (v2->_ny - v1->_ny) * oneoverfactor;
+	vOut->_nz = (v2->_nz - v1->_nz) * oneoverfactor;
+	vOut->_u = (v2->_u - v1->_u) * oneoverfactor;
+	vOut->_v = (v2->_v - v1->_v) * oneoverfactor;
+	vOut->_lightcolor._r = (v2->_lightcolor._r - v1->_lightcolor._r) * oneoverfactor;
+	vOut->_lightcolor._g = (v2->_lightcolor._g - v1->_lightcolor._g) * oneoverfactor;
+	vOut->_lightcolor._b = (v2->_lightcolor._b - v1->_lightcolor._b) * oneoverfactor;
+	vOut->_vpos.x = (v2->_vpos.x - v1->_vpos.x) * oneoverfactor;
+	vOut->_vpos.y = (v2->_vpos.y - v1->_vpos.y) * oneoverfactor;
+	vOut->_vpos.z = (v2->_vpos.z - v1->_vpos.z) * oneoverfactor;
+}
+
+void Device::VertexAdd(FPVertex *vOut, FPVertex *step) {
+	vOut->_x += step->_x;
+	vOut->_y += step->_y;
+	vOut->_z += step->_z;
+	vOut->_w += step->_w;
+	vOut->_r += step->_r;
+	vOut->_g += step->_g;
+	vOut->_b += step->_b;
+	vOut->_u += step->_u;
+	vOut->_v += step->_v;
+	vOut->_nx += step->_nx;
+	vOut->_ny += step->_ny;
+	vOut->_nz += step->_nz;
+	vOut->_lightcolor._r += step->_lightcolor._r;
+	vOut->_lightcolor._g += step->_lightcolor._g;
+	vOut->_lightcolor._b += step->_lightcolor._b;
+	vOut->_vpos.x += step->_vpos.x;
+	vOut->_vpos.y += step->_vpos.y;
+	vOut->_vpos.z += step->_vpos.z;
+}
+
+/**********************************************************************************
+	Scanline edges used to be re-interpolated in float on every scanline, because stepping
+	them with VertexAdd accumulated error and an x of 0.999 instead of 1.001 put the span's
+	first pixel one off, leaving holes between triangles. Now the vertices are snapped to
+	FP_SUBPIXEL fixed point like RASTER_HALFSPACE and the edges are stepped in integers, so
+	the pixels a scanline covers are exact however far it is stepped: pixel centers on the
+	top or left edge are in, on the bottom or right edge are out, and a pixel on an edge
+	shared by two triangles is filled by exactly one. Only the attributes are stepped in
+	float, where a little error shows as nothing worse than a slightly different shade.
+**/
+
+// integer division rounded down and up, d > 0
+static long long FloorDiv(long long n, long long d) {
+	long long q = n / d;
+	return q * d > n ? q - 1 : q;
+}
+
+static long long CeilDiv(long long n, long long d) {
+	long long q = n / d;
+	return q * d < n ? q + 1 : q;
+}
+
+void Device::SetupScanEdge(FPScanEdge *edge, const FPVertex *v1, const FPVertex *v2, int y,
+	bool attributes) {
+	int x1 = FPToFixed(v1->_x), y1 = FPToFixed(v1->_y);
+	int x2 = FPToFixed(v2->_x), y2 = FPToFixed(v2->_y);
+	int dx = x2 - x1, dy = y2 - y1;
+	assert(dy > 0);
+	// the edge crosses scanline y at x = n / den pixels
+	long long n = (long long)x1 * dy + (long long)dx * (y * FP_SUBPIXEL - y1);
+	edge->den = dy * FP_SUBPIXEL;
+	edge->oneoverden = 1.0f / edge->den;
+	edge->x = (int)CeilDiv(n, edge->den);
+	edge->rem = (int)(edge->x * (long long)edge->den - n);
+	// n grows by dx * FP_SUBPIXEL per scanline
+	edge->stepx = (int)FloorDiv((long long)dx * FP_SUBPIXEL, edge->den);
+	edge->steprem = dx * FP_SUBPIXEL - edge->stepx * edge->den;
+	if (attributes) {
+		VertexInterpolation(&edge->v, v1, v2, (y - v1->_y) / (v2->_y - v1->_y));
+		VertexDivision(&edge->step, v1, v2, v2->_y - v1->_y);
+	}
+	edge->v._x = edge->x - edge->rem * edge->oneoverden;
+}
+
+void Device::StepScanEdge(FPScanEdge *edge, bool attributes) {
+	edge->x += edge->stepx;
+	edge->rem -= edge->steprem;
+	if (edge->rem < 0) {
+		edge->rem += edge->den;
+		edge->x++;
+	}
+	if (attributes)
+		VertexAdd(&edge->v, &edge->step);
+	edge->v._x = edge->x - edge->rem * edge->oneoverden;
+}
+
+void Device::FillOnePrimitive(const FPVertex *v1, const FPVertex *v2, const FPVertex *v3,
+	FPRasterContext *ctx) {
+	int x1 = FPToFixed(v1->_x), y1 = FPToFixed(v1->_y);
+	int x2 = FPToFixed(v2->_x), y2 = FPToFixed(v2->_y);
+	int x3 = FPToFixed(v3->_x), y3 = FPToFixed(v3->_y);
+	// v2 is right of the long edge v1 v3 when this is positive
+	long long area = (long long)(x2 - x1) * (y3 - y1) - (long long)(x3 - x1) * (y2 - y1);
+	if (area == 0)
+		return;
+	// scanlines whose pixel centers are in [y1, y3)
+	int top = (y1 + FP_SUBPIXEL - 1) >> FP_SUBPIXEL_BITS;
+	int middle = (y2 + FP_SUBPIXEL - 1) >> FP_SUBPIXEL_BITS;
+	int bottom = min((y3 + FP_SUBPIXEL - 1) >> FP_SUBPIXEL_BITS, ctx->clip.y1);
+	int start = max(top, ctx->clip.y0);
+	if (start >= bottom)
+		return;
+	bool attributes = ctx->bary == nullptr;
+	FPScanEdge *edges = ctx->arena->New<FPScanEdge>(2);
+	FPScanEdge *longedge = &edges[0], *shortedge = &edges[1];
+	for (int yIndex = start; yIndex < bottom; yIndex++) {
+		// x is exact wherever the edges are set up, attributes are interpolated afresh on
+		// every bin tile's first scanline too, so they come out the same drawn tiled or not
+		bool restart = yIndex == start || (attributes && yIndex % FP_TILESIZE == 0);
+		if (restart)
+			SetupScanEdge(longedge, v1, v3, yIndex, attributes);
+		// v1 v2 first, v2 v3 from the middle on
+		if (restart && yIndex < middle)
+			SetupScanEdge(shortedge, v1, v2, yIndex, attributes);
+		else if (restart || yIndex == middle)
+			SetupScanEdge(shortedge, v2, v3, yIndex, attributes);
+		const FPScanEdge *left = area > 0 ? longedge : shortedge;
+		const FPScanEdge *right = area > 0 ? shortedge : longedge;
+		if (left->x < right->x) {
+			if (ctx->bary)
+				DrawBarycentricScanLine(left->x, right->x, yIndex, ctx);
+			else
+				DrawScanLine(&left->v, &right->v, left->x, right->x, yIndex, ctx);
+		}
+		StepScanEdge(longedge, attributes);
+		StepScanEdge(shortedge, attributes);
+	}
+}
+
+void Device::UpdateTransforms() {
+	if (!_wvdirty)
+		return;
+	// affine products, the projection only comes in last
+	_worldview = _world * _view;
+	Matrix_InverseTranspose3x3(&_normalmat, &_worldview);
+	_wvp = _worldview * _proj;
+	_frustum = Frustum_FromMatrix(_wvp);
+	_wvdirty = false;
+}
+
+void Device::ProcessVertices(int first, int count, FPTransformedVertex *out) {
+	// matrices and light once per draw
+	if (_lightenable)
+		UpdateLightUniforms();
+	UpdateTransforms();
+	// gather into streams and transform them in batches
+	_spos.Resize(count);
+	if (_lightenable)
+		_snormalin.Resize(count);
+	for (int i = 0; i < count; i++) {
+		const FPVertex *v = &_vb[first + i];
+		_spos.x[i] = v->_x; _spos.y[i] = v->_y; _spos.z[i] = v->_z; _spos.w[i] = v->_w;
+		if (_lightenable) {
+			_snormalin.x[i] = v->_nx; _snormalin.y[i] = v->_ny; _snormalin.z[i] = v->_nz;
+		}
+	}
+	Vec4_TransformStream(&_sclip, &_spos, &_wvp);
+	if (_lightenable) {
+		Vec4_TransformStream(&_sview, &_spos, &_worldview);
+		Vec3_TransformNormalStream(&_snormal, &_snormalin, &_normalmat);
+	}
+	for (int i = 0; i < count; i++) {
+		FPTransformedVertex *t = &out[i];
+		t->clip = MLVector4(_sclip.x[i], _sclip.y[i], _sclip.z[i], _sclip.w[i]);
+		// if enable light, calculate vertex light color in view as view vector can be easy
+		if (_lightenable) {
+			t->view = MLVector4(_sview.x[i], _sview.y[i], _sview.z[i], _sview.w[i]);
+			t->normal = MLVector4(_snormal.x[i], _snormal.y[i], _snormal.z[i], 0.0f);
+			if (_shade == SHADE_GOURAUD)
+				t->lightcolor = GetLightColor(&t->normal, &t->view);
+		}
+	}
+}
+
+int Device::ClipPrimitive(int i1, int i2, int i3, FPClipVertex *poly) {
+	int index[3] = { i1, i2, i3 };
+	int code[3];
+	for (int k = 0; k < 3; k++) {
+		const FPVertex *v = &_vb[index[k]];
+		poly[k].t = _tv[index[k] - _tvfirst];
+		poly[k].r = v->_r;
+		poly[k].g = v->_g;
+		poly[k].b = v->_b;
+		poly[k].u = v->_u;
+		poly[k].v = v->_v;
+		code[k] = ClipCode(&poly[k].t.clip);
+	}
+	// every vertex outside the same plane
+	if (code[0] & code[1] & code[2])
+		return 0;
+	int planes = (code[0] | code[1] | code[2]) & FP_CLIPPLANES;
+	if (!planes)
+		return 3;
+	// Sutherland-Hodgman, only against the planes some vertex is outside of
+	FPClipVertex temp[FP_MAXCLIPVERTS];
+	FPClipVertex *in = poly, *out = temp;
+	int count = 3;
+	for (int plane = FP_CLIPNEAR; plane <= FP_CLIPGUARDTOP; plane <<= 1) {
+		if (!(planes & plane))
+			continue;
+		int n = 0;
+		for (int k = 0; k < count; k++) {
+			const FPClipVertex *a = &in[k], *b = &in[(k + 1) % count];
+			float da = ClipDistance(&a->t.clip, plane), db = ClipDistance(&b->t.clip, plane);
+			if (da >= 0.0f)
+				out[n++] = *a;
+			// always from the inside end, so an edge shared by two triangles is cut the same
+			if (da >= 0.0f && db < 0.0f)
+				ClipVertexInterpolation(&out[n++], a, b, da / (da - db));
+			else if (da < 0.0f && db >= 0.0f)
+				ClipVertexInterpolation(&out[n++], b, a, db / (db - da));
+		}
+		if (n < 3)
+			return 0;
+		count = n;
+		std::swap(in, out);
+	}
+	if (in != poly) {
+		for (int k = 0; k < count; k++)
+			poly[k] = in[k];
+	}
+	return count;
+}
+
+bool Device::SetupPrimitive(const FPClipVertex *c1, const FPClipVertex *c2,
+	const FPClipVertex *c3, FPTriangle *tri) {
+	const MLVector4 &vp1 = c1->t.view, &vp2 = c2->t.view, &vp3 = c3->t.view;
+	// normals are only written with lighting, garbage stepped along a span can be denormal
+	const MLVector4 zero(0.0f, 0.0f, 0.0f, 0.0f);
+	const MLVector4 &n1 = _lightenable ? c1->t.normal : zero;
+	const MLVector4 &n2 = _lightenable ? c2->t.normal : zero;
+	const MLVector4 &n3 = _lightenable ? c3->t.normal : zero;
+	const Color &lightcolor1 = c1->t.lightcolor;
+	const Color &lightcolor2 = c2->t.lightcolor;
+	const Color &lightcolor3 = c3->t.lightcolor;
+	MLVector4 p1 = c1->t.clip, p2 = c2->t.clip, p3 = c3->t.clip;
+	// third projection division and viewport transformation for rasterization
+	// remember to store real z first before division
+	float z1 = p1.w;
+	float z2 = p2.w;
+	float z3 = p3.w;
+	p1 /= p1.w; p2 /= p2.w; p3 /= p3.w;
+	if (!Backface_Culling(&p1, &p2, &p3))
+		return false;
+	p1 = Vec4_Transform(p1, _viewport);
+	p2 = Vec4_Transform(p2, _viewport);
+	p3 = Vec4_Transform(p3, _viewport);
+	tri->p[0] = p1;
+	tri->p[1] = p2;
+	tri->p[2] = p3;
+	// bounding rect, one pixel wider for the lines of wireframe
+	float minx = min(p1.x, min(p2.x, p3.x)), maxx = max(p1.x, max(p2.x, p3.x));
+	float miny = min(p1.y, min(p2.y, p3.y)), maxy = max(p1.y, max(p2.y, p3.y));
+	tri->bound = FPRect(max((int)floorf(minx), 0), max((int)floorf(miny), 0),
+		min((int)ceilf(maxx) + 1, _width), min((int)ceilf(maxy) + 1, _height));
+	tri->mipratio = 0.0f;
+
+	if (_rstate == FILL_WIREFRAME)
+		return true;
+	if (_rstate == FILL_COLOR || _rstate == FILL_TEXTURE) {
+		// if texture mipmaping, choose level to use
+		if (_rstate == FILL_TEXTURE && _sample == SAMPLE_MIPMAP) {
+			tri->mipratio = GenerateMipMapRatio(&p1, &p2, &p3);
+		}
+		// fill primitive
+		if (Float_Equals(p1.y, p2.y) && Float_Equals(p2.y, p3.y))
+			return false;
+		if (Float_Equals(p1.x, p2.x) && Float_Equals(p2.x, p3.x))
+			return false;
+		FPVertex r1(p1.x, p1.y, p1.z, c1->r / z1, c1->g / z1, c1->b / z1, n1.x / z1, n1.y / z1,
+			n1.z / z1, c1->u / z1, c1->v / z1);
+		FPVertex r2(p2.x, p2.y, p2.z, c2->r / z2, c2->g / z2, c2->b / z2, n2.x / z2, n2.y / z2,
+			n2.z / z2, c2->u / z2, c2->v / z2);
+		FPVertex r3(p3.x, p3.y, p3.z, c3->r / z3, c3->g / z3, c3->b / z3, n3.x / z3, n3.y / z3,
+			n3.z / z3, c3->u / z3, c3->v / z3);
+		// remember to store real z
+		r1._w = 1.0f / z1;
+		r2._w = 1.0f / z2;
+		r3._w = 1.0f / z3;
+		// the same for what the shade mode doesn't use
+		r1._lightcolor = r2._lightcolor = r3._lightcolor = Color(0.0f, 0.0f, 0.0f);
+		r1._vpos = r2._vpos = r3._vpos = MLVector3(0.0f, 0.0f, 0.0f);
+		// remember to store light color / z or view xyz / z if light enable
+		if (_lightenable) {
+			if (_shade == SHADE_GOURAUD) {
+				r1._lightcolor = lightcolor1 * r1._w;
+				r2._lightcolor = lightcolor2 * r2._w;
+				r3._lightcolor = lightcolor3 * r3._w;
+			}
+			else if (_shade == SHADE_PHONG) {
+				r1._vpos = MLVector3(vp1.x, vp1.y, vp1.z) * r1._w;
+				r2._vpos = MLVector3(vp2.x, vp2.y, vp2.z) * r2._w;
+				r3._vpos = MLVector3(vp3.x, vp3.y, vp3.z) * r3._w;
+			}
+		}
+		// sort by y
+		if (p1.y < p2.y) {
+			if (p2.y < p3.y) {
+				// p1 p2 p3
+				tri->v[0] = r1;
+				tri->v[1] = r2;
+				tri->v[2] = r3;
+			}
+			else if (p1.y < p3.y) {
+				// p1 p3 p2
+				tri->v[0] = r1;
+				tri->v[1] = r3;
+				tri->v[2] = r2;
+			}
+			else {
+				// p3 p1 p2
+				tri->v[0] = r3;
+				tri->v[1] = r1;
+				tri->v[2] = r2;
+			}
+		}
+		else {
+			if (p2.y > p3.y) {
+				// p3 p2 p1
+				tri->v[0] = r3;
+				tri->v[1] = r2;
+				tri->v[2] = r1;
+			}
+			else if(p1.y > p3.y) {
+				// p2 p3 p1
+				tri->v[0] = r2;
+				tri->v[1] = r3;
+				tri->v[2] = r1;
+			}
+			else {
+				// p2 p1 p3
+				tri->v[0] = r2;
+				tri->v[1] = r1;
+				tri->v[2] = r3;
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+void Device::RasterPrimitive(const FPTriangle *tri, FPRasterContext *ctx) {
+	ctx->tri = tri;
+	FPRect rect(max(tri->bound.x0, ctx->clip.x0), max(tri->bound.y0, ctx->clip.y0),
+		min(tri->bound.x1, ctx->clip.x1), min(tri->bound.y1, ctx->clip.y1));
+	if (_rstate == FILL_WIREFRAME) {
+		ResolveClear(&rect);
+		// draw line, only the outline of a clipped polygon and not the diagonals of its fan
+		for (int k = 0; k < 3; k++) {
+			if (tri->edges & (1 << k))
+				BresenhamDrawLine(&tri->p[k], &tri->p[(k + 1) % 3], ctx);
+		}
+		return;
+	}
+	if (_rstate == FILL_COLOR || _rstate == FILL_TEXTURE) {
+		// whole triangle behind what is drawn already
+		float zmin = min(tri->v[0]._z, min(tri->v[1]._z, tri->v[2]._z));
+		if (HiZReject(&rect, zmin))
+			return;
+		ResolveClear(&rect);
+		// temporaries live until the triangle is done
+		FPArenaMarker marker = ctx->arena->GetMarker();
+		ctx->bary = nullptr;
+		if (_raster == RASTER_HALFSPACE)
+			FillHalfSpacePrimitive(tri, ctx);
+		else {
+			if (_interpolate == INTERPOLATE_BARYCENTRIC) {
+				FPBaryInterp *bary = ctx->arena->New<FPBaryInterp>();
+				SetupBarycentric(tri, bary);
+				ctx->bary = bary;
+			}
+			FillOnePrimitive(&tri->v[0], &tri->v[1], &tri->v[2], ctx);
+		}
+		ctx->arena->Rewind(marker);
+	}
+}
+
+// edges of fan triangle poly[0] poly[k - 1] poly[k] on the outline of a count vertex polygon
+static int FanEdges(int k, int count) {
+	return 2 | (k == 2 ? 1 : 0) | (k == count - 1 ? 4 : 0);
+}
+
+void Device::DrawOnePrimitive(int i1, int i2, int i3) {
+	FPClipVertex poly[FP_MAXCLIPVERTS];
+	int count = ClipPrimitive(i1, i2, i3, poly);
+	FPRasterContext ctx;
+	ctx.clip = FPRect(0, 0, _width, _height);
+	ctx.arena = _arenas[0];
+	// the polygon left is convex, fan it out from its first vertex
+	for (int k = 2; k < count; k++) {
+		FPTriangle tri;
+		if (!SetupPrimitive(&poly[0], &poly[k - 1], &poly[k], &tri))
+			continue;
+		tri.edges = FanEdges(k, count);
+		RasterPrimitive(&tri, &ctx);
+	}
+}
+
+void Device::BeginBins(int TriCount) {
+	_drawmark = _arenas[0]->GetMarker();
+	// room for one triangle clipped into the most pieces on top, so a draw normally fits
+	_tricapacity = TriCount + FP_MAXCLIPTRIS;
+	_tris = _arenas[0]->New<FPTriangle>(_tricapacity);
+	_tricount = 0;
+}
+
+void Device::BinOnePrimitive(int i1, int i2, int i3) {
+	FPClipVertex poly[FP_MAXCLIPVERTS];
+	int count = ClipPrimitive(i1, i2, i3, poly);
+	// too many triangles were clipped into pieces, rasterize the bins and start over
+	if (_tricount + count - 2 > _tricapacity) {
+		int TriCount = _tricapacity - FP_MAXCLIPTRIS;
+		FlushBins();
+		BeginBins(TriCount);
+	}
+	for (int k = 2; k < count; k++) {
+		FPTriangle *tri = &_tris[_tricount];
+		if (!SetupPrimitive(&poly[0], &poly[k - 1], &poly[k], tri))
+			continue;
+		if (tri->bound.x0 >= tri->bound.x1 || tri->bound.y0 >= tri->bound.y1)
+			continue;
+		tri->edges = FanEdges(k, count);
+		_tricount++;
+	}
+}
+
+void Device::FlushBins() {
+	FPArena *arena = _arenas[0];
+	int tiles = _tilesx * _tilesy;
+	// count triangles per tile, then store the bins back to back in one list
+	// bin of tile t is binlist[binstart[t]] .. binlist[binstart[t + 1] - 1]
+	int *binstart = arena->New<int>(tiles + 1);
+	for (int i = 0; i <= tiles; i++)
+		binstart[i] = 0;
+	for (int i = 0; i < _tricount; i++) {
+		const FPRect &bound = _tris[i].bound;
+		for (int ty = bound.y0 / FP_TILESIZE; ty <= (bound.y1 - 1) / FP_TILESIZE; ty++) {
+			for (int tx = bound.x0 / FP_TILESIZE; tx <= (bound.x1 - 1) / FP_TILESIZE; tx++)
+				binstart[ty * _tilesx + tx + 1]++;
+		}
+	}
+	for (int i = 0; i < tiles; i++)
+		binstart[i + 1] += binstart[i];
+	int *binlist = arena->New<int>(binstart[tiles]);
+	int *binend = arena->New<int>(tiles);
+	for (int i = 0; i < tiles; i++)
+		binend[i] = binstart[i];
+	for (int i = 0; i < _tricount; i++) {
+		const FPRect &bound = _tris[i].bound;
+		for (int ty = bound.y0 / FP_TILESIZE; ty <= (bound.y1 - 1) / FP_TILESIZE; ty++) {
+			for (int tx = bound.x0 / FP_TILESIZE; tx <= (bound.x1 - 1) / FP_TILESIZE; tx++)
+				binlist[binend[ty * _tilesx + tx]++] = i;
+		}
+	}
+
+	if (!_pool)
+		_pool = new FPThreadPool(_workers);
+	while ((int)_arenas.size() < _pool->GetThreadCount())
+		_arenas.push_back(new FPArena);
+	// each tile is owned by exactly one worker, so no pixel is shared between threads
+	// and triangles inside a tile keep submission order
+	_pool->Run(tiles, [this, binstart, binlist](int tile, int worker) {
+		if (binstart[tile] == binstart[tile + 1])
+			return;
+		int tx = tile % _tilesx, ty = tile / _tilesx;
+		FPRasterContext ctx;
+		ctx.clip = FPRect(tx * FP_TILESIZE, ty * FP_TILESIZE, min((tx + 1) * FP_TILESIZE, _width),
+			min((ty + 1) * FP_TILESIZE, _height));
+		ctx.arena = _arenas[worker];
+		for (int i = binstart[tile]; i < binstart[tile + 1]; i++)
+			RasterPrimitive(&_tris[binlist[i]], &ctx);
+	});
+	arena->Rewind(_drawmark);
+	_tris = nullptr;
+	_tricount = 0;
+}
+
+void Device::DrawTriangles(const int *ib, int first, int TriCount) {
+	if (TriCount <= 0)
+		return;
+	if (_bounded && !BoundsVisible(&_boundmin, &_boundmax))
+		return;
+	// every referenced vertex is transformed and lit once, triangles only look them up
+	int lo = first, hi = first + TriCount * 3 - 1;
+	if (ib) {
+		lo = hi = ib[0];
+		for (int i = 1; i < TriCount * 3; i++) {
+			lo = min(lo, ib[i]);
+			hi = max(hi, ib[i]);
+		}
+	}
+	UpdateKernels();
+	FPArena *arena = _arenas[0];
+	FPArenaMarker marker = arena->GetMarker();
+	_tv = arena->New<FPTransformedVertex>(hi - lo + 1);
+	_tvfirst = lo;
+	ProcessVertices(lo, hi - lo + 1, _tv);
+	// ready to draw
+	if (_bin == BIN_TILED)
+		BeginBins(TriCount);
+	for (int i = 0; i < TriCount; i++) {
+		int i1 = ib ? ib[i * 3] : first + i * 3;
+		int i2 = ib ? ib[i * 3 + 1] : first + i * 3 + 1;
+		int i3 = ib ? ib[i * 3 + 2] : first + i * 3 + 2;
+		if (_bin == BIN_TILED)
+			BinOnePrimitive(i1, i2, i3);
+		else
+			DrawOnePrimitive(i1, i2, i3);
+	}
+	if (_bin == BIN_TILED)
+		FlushBins();
+	arena->Rewind(marker);
+	_tv = nullptr;
+}
+
+void Device::DrawPrimitive(int startIndex, int TriCount) {
+	DrawTriangles(nullptr, startIndex, TriCount);
+}
+
+void Device::DrawIndexedPrimitive(int startIndex, int TriCount) {
+	DrawTriangles(_ib + startIndex, 0, TriCount);
+}
+
+void Device::ResolveTileClear(int tx, int ty, int buffers) {
+	unsigned char &pending = _tileclear[ty * _tilesx + tx];
+	buffers &= pending;
+	if (!buffers)
+		return;
+	int x0 = tx * FP_TILESIZE, y0 = ty * FP_TILESIZE;
+	if (buffers & FP_CLEARCOLOR) {
+		int x1 = min(x0 + FP_TILESIZE, _width), y1 = min(y0 + FP_TILESIZE, _height);
+		for (int y = y0; y < y1; y++)
+			FPFill32(_backbuf + y * _pitch + x0, _clearcolor, x1 - x0);
+	}
+	if (buffers & FP_CLEARDEPTH) {
+		// edge tiles take the padding of their hiz squares along
+		int x1 = min(x0 + FP_TILESIZE, _hizpitch * FP_HIZSIZE);
+		int y1 = min(y0 + FP_TILESIZE, (_height + FP_HIZSIZE - 1) / FP_HIZSIZE * FP_HIZSIZE);
+		for (int y = y0; y < y1; y++)
+			FPFill32(_zbuf + y * _zpitch + x0, _clearz, x1 - x0);
+	}
+	pending &= ~buffers;
+}
+
+void Device::ResolveClear(const FPRect *rect) {
+	if (rect->x0 >= rect->x1 || rect->y0 >= rect->y1)
+		return;
+	for (int ty = rect->y0 / FP_TILESIZE; ty <= (rect->y1 - 1) / FP_TILESIZE; ty++) {
+		for (int tx = rect->x0 / FP_TILESIZE; tx <= (rect->x1 - 1) / FP_TILESIZE; tx++)
+			ResolveTileClear(tx, ty, FP_CLEARCOLOR | FP_CLEARDEPTH);
+	}
+}
+
+float Device::GetHiZ(int tx, int ty) {
+	int index = ty * _hizpitch + tx;
+	if (_hizdirty[index]) {
+		const float *z = _zbuf + ty * FP_HIZSIZE * _zpitch + tx * FP_HIZSIZE;
+#if defined(ML_SIMD_AVX)
+		__m256 zmax8 = _mm256_load_ps(z);
+		for (int y = 1; y < FP_HIZSIZE; y++)
+			zmax8 = _mm256_max_ps(zmax8, _mm256_load_ps(z + y * _zpitch));
+		__m128 zmax = _mm_max_ps(_mm256_castps256_ps128(zmax8), _mm256_extractf128_ps(zmax8, 1));
+#elif defined(ML_SIMD_SSE2)
+		__m128 zmax = _mm_max_ps(_mm_load_ps(z), _mm_load_ps(z + 4));
+		for (int y = 1; y < FP_HIZSIZE; y++) {
+			zmax = _mm_max_ps(zmax, _mm_load_ps(z + y * _zpitch));
+			zmax = _mm_max_ps(zmax, _mm_load_ps(z + y * _zpitch + 4));
+		}
+#endif
+#if defined(ML_SIMD_SSE2)
+		zmax = _mm_max_ps(zmax, _mm_shuffle_ps(zmax, zmax, _MM_SHUFFLE(1, 0, 3, 2)));
+		zmax = _mm_max_ps(zmax, _mm_shuffle_ps(zmax, zmax, _MM_SHUFFLE(2, 3, 0, 1)));
+		_hiz[index] = _mm_cvtss_f32(zmax);
+#else
+		float zmax = z[0];
+		for (int y = 0; y < FP_HIZSIZE; y++) {
+			for (int x = 0; x < FP_HIZSIZE; x++)
+				zmax = max(zmax, z[y * _zpitch + x]);
+		}
+		_hiz[index] = zmax;
+#endif
+		_hizdirty[index] = 0;
+	}
+	return _hiz[index];
+}
+
+bool Device::HiZReject(const FPRect *rect, float z) {
+	if (rect->x0 >= rect->x1 || rect->y0 >= rect->y1)
+		return true;
+	for (int ty = rect->y0 / FP_HIZSIZE; ty <= (rect->y1 - 1) / FP_HIZSIZE; ty++) {
+		for (int tx = rect->x0 / FP_HIZSIZE; tx <= (rect->x1 - 1) / FP_HIZSIZE; tx++) {
+			if (z < GetHiZ(tx, ty))
+				return false;
+		}
+	}
+	return true;
+}
+
+void Device::SetBackBuffer(int x, int y, unsigned int color) {
+	if (x >= 0 && x < _width && y >= 0 && y < _height)
+		_backbuf[y * _pitch + x] = color;
+}
+
+void Device::SetBackBuffer(int x, int y, unsigned int color, const FPRect *clip) {
+	if (clip->Contains(x, y))
+		SetBackBuffer(x, y, color);
+}
+
+void Device::Present() {
+	size_t peak = 0;
+	for (size_t i = 0; i < _arenas.size(); i++)
+		peak += _arenas[i]->Reset();
+	_arenapeak = peak;
+	// untouched tiles only need their color, a pending depth clear can wait
+	for (int ty = 0; ty < _tilesy; ty++) {
+		for (int tx = 0; tx < _tilesx; tx++)
+			ResolveTileClear(tx, ty, FP_CLEARCOLOR);
+	}
+	_rt->Present();
+}
+
+size_t Device::GetArenaHighWater() const {
+	return _arenapeak;
+}
@@ -0,0 +1,416 @@
+#pragma once
+#include "FPTypes.h"
+#include "FPTexture.h"
+#include "FPRenderTarget.h"
+#include "FPThreadPool.h"
+#include "FPMemory.h"
+#include <vector>
+
+// screen tile edge in pixels for BIN_TILED
+const int FP_TILESIZE = 64;
+// edge in pixels of the squares hierarchical z keeps the farthest depth of
+const int FP_HIZSIZE = 8;
+// a hiz square never straddles two bin tiles, so workers don't share one
+static_assert(FP_TILESIZE % FP_HIZSIZE == 0, "bin tiles must be whole hiz squares");
+// subpixel bits of the fixed point triangle setup of both rasterizers
+const int FP_SUBPIXEL_BITS = 4;
+const int FP_SUBPIXEL = 1 << FP_SUBPIXEL_BITS;
+// buffers of a tile with a pending CLEAR_DEFERRED clear
+const int FP_CLEARCOLOR = 1;
+const int FP_CLEARDEPTH = 2;
+
+// screen coordinate in fixed point, rounded to the nearest subpixel
+inline int FPToFixed(float v) {
+	return (int)floorf(v * FP_SUBPIXEL + 0.5f);
+}
+
+// pixel rectangle [x0, x1) x [y0, y1)
+struct FPRect {
+	int x0, y0, x1, y1;
+	FPRect() {}
+	FPRect(int x0, int y0, int x1, int y1) {
+		this->x0 = x0; this->y0 = y0; this->x1 = x1; this->y1 = y1;
+	}
+	bool Contains(int x, int y) const {
+		return x >= x0 && x < x1 && y >= y0 && y < y1;
+	}
+};
+
+// triangle after transform, clip, projection and viewport, ready to rasterize
+struct FPTriangle {
+	// screen space vertices sorted by y, attributes divided by w
+	FPVertex v[3];
+	// screen space position in submission order, for wireframe
+	MLVector4 p[3];
+	// wireframe: bit k set if edge p[k] p[(k + 1) % 3] is on the clipped polygon's outline
+	int edges;
+	// mipmap ratio
+	float mipratio;
+	// covered pixels
+	FPRect bound;
+};
+
+// light and material baked for lighting in view space
+struct FPLightUniforms {
+	LIGHTTYPE type;
+	// view space position and unit direction the light shines along
+	MLVector3 position;
+	MLVector3 direction;
+	// unit vector towards LIGHT_DIRECTIONAL
+	MLVector3 tolight;
+	float range;
+	float attenuation0, attenuation1, attenuation2;
+	// cosine of half the inner and outer spot cone angles
+	float costheta, cosphi;
+	float falloff;
+	// material times light terms
+	Color emissiveambient;
+	Color diffuse;
+	Color specular;
+	float power;
+};
+
+// vertex after the per-draw vertex stage
+struct FPTransformedVertex {
+	// clip space position
+	MLVector4 clip;
+	// view space position and normal, only with lighting
+	MLVector4 view;
+	MLVector4 normal;
+	// lighting result, only with SHADE_GOURAUD
+	Color lightcolor;
+};
+
+// vertex of a triangle being clipped, everything still linear in clip space
+struct FPClipVertex {
+	FPTransformedVertex t;
+	// color and texture coordinates
+	float r, g, b, u, v;
+};
+
+// state of one rasterization job, one per thread
+struct FPBaryInterp;
+
+struct FPRasterContext {
+	// pixels outside are never touched
+	FPRect clip;
+	// triangle being rasterized
+	const FPTriangle *tri;
+	// INTERPOLATE_BARYCENTRIC: its depth and barycentric planes, otherwise nullptr
+	const FPBaryInterp *bary;
+	// temporaries of this job
+	FPArena *arena;
+};
+
+// most attributes a raster kernel interpolates: color, uv, light color, normal, view position
+const int FP_MAXINTERP = 14;
+
+// attributes along a scanline, packed by FPRasterKernels::pack
+// depth at pixel x is z + dz * (x - zorigin), the rest is a + da * (x - origin)
+struct FPSpanInterp {
+	float z, dz;
+	int zorigin;
+	// 1 / w, unused by a span of attributes that are perspective correct already
+	float w, dw;
+	int origin;
+	float a[FP_MAXINTERP], da[FP_MAXINTERP];
+};
+
+// attributes over a triangle, packed by FPRasterKernels::pack
+// value at pixel (x, y) is a + dadx * (x - x0) + dady * (y - y0)
+struct FPPlaneInterp {
+	float x0, y0;
+	float z, dzdx, dzdy;
+	float w, dwdx, dwdy;
+	float a[FP_MAXINTERP], dadx[FP_MAXINTERP], dady[FP_MAXINTERP];
+};
+
+// depth and barycentrics over a triangle, attributes at its vertices packed by
+// FPRasterKernels::pack but not divided by w
+// z, w, b1 and b2 at pixel (x, y) are planes like in FPPlaneInterp, b1 and b2 are the
+// barycentrics of tri->v[1] and tri->v[2] divided by w
+// an attribute is a + da1 * b1 / w + da2 * b2 / w
+struct FPBaryInterp {
+	float x0, y0;
+	float z, dzdx, dzdy;
+	float w, dwdx, dwdy;
+	float b1, db1dx, db1dy;
+	float b2, db2dx, db2dy;
+	float a[FP_MAXINTERP], da1[FP_MAXINTERP], da2[FP_MAXINTERP];
+};
+
+// triangle edge walked down one scanline at a time, ends in fixed point
+// x is exactly ceil of where the edge crosses the current scanline, which is
+// x - rem / den, so it only ever moves by whole steps and integer carries
+struct FPScanEdge {
+	int x, rem, den;
+	float oneoverden;
+	// change of x and rem per scanline
+	int stepx, steprem;
+	// attributes on the edge at the current scanline and their change per scanline,
+	// unused for INTERPOLATE_BARYCENTRIC
+	FPVertex v, step;
+};
+
+struct FPRasterKernels;
+
+// create device
+struct Device {
+	// render target, owned by caller
+	FPRenderTarget *_rt;
+	// back buffer
+	unsigned int *_backbuf;
+	// depth buffer, row major, padded to whole hiz squares
+	float *_zbuf;
+	// floats per depth buffer row
+	int _zpitch;
+	// farthest depth of every FP_HIZSIZE square, never nearer than the depth below it
+	float *_hiz;
+	// square was written since its _hiz was computed
+	unsigned char *_hizdirty;
+	// hiz squares per row
+	int _hizpitch;
+	// width and height
+	int _width, _height;
+	// pixels per back buffer row
+	int _pitch;
+	// vertex buffer input
+	FPVertex *_vb;
+	// index buffer input
+	int *_ib;
+	// world matrix
+	MLAffine3x4 _world;
+	// view matrix
+	MLAffine3x4 _view;
+	// projection matrix
+	MLMatrix4 _proj;
+	// viewport matrix of the render target, fixed at creation
+	MLMatrix4 _viewport;
+	// world * view, its normal matrix, world * view * projection and its object space frustum,
+	// rebuilt on draw after a transform changed
+	MLAffine3x4 _worldview;
+	MLMatrix4 _normalmat;
+	MLMatrix4 _wvp;
+	MLFrustum _frustum;
+	bool _wvdirty;
+	// object space box of the following draws, see SetBounds
+	MLVector3 _boundmin, _boundmax;
+	bool _bounded;
+	// render state
+	FILLTYPE _rstate;
+	// shade mode
+	SHADETYPE _shade;
+	// sample state
+	SAMPLETYPE _sample;
+	// material
+	Material *_mtrl;
+	// light
+	Light *_light;
+	// light status
+	bool _lightenable;
+	// _light and _mtrl in view space, rebuilt on draw after they or the view changed
+	FPLightUniforms _lu;
+	bool _ludirty;
+	// bound texture, referenced while bound
+	FPTextureResource *_texres;
+	// its mip levels, _tex[0] is the full size one
+	const Texture *_tex;
+	// level of details in texture for mipmaping
+	int _LOD;
+	// triangle filling algorithm
+	RASTERTYPE _raster;
+	// kernels for the fill state of the current draw, nullptr for wireframe
+	const FPRasterKernels *_kernels;
+	// how often attributes are divided by w along a scanline
+	PERSPECTIVETYPE _perspective;
+	// PERSPECTIVE_SPAN*: how many pixels an interpolated attribute may be off by
+	float _perspectiveerror;
+	// what a scanline steps, INTERPOLATE_BARYCENTRIC ignores _perspective
+	INTERPOLATETYPE _interpolate;
+	// how triangles are handed to the rasterizer
+	BINTYPE _bin;
+	// workers for BIN_TILED, created on first use
+	FPThreadPool *_pool;
+	// worker count for BIN_TILED, 0 means one per hardware thread
+	int _workers;
+	// tiles per row and column
+	int _tilesx, _tilesy;
+	// how Clear() writes the buffers
+	CLEARTYPE _clear;
+	// FP_CLEARCOLOR | FP_CLEARDEPTH bits per tile still to be written
+	unsigned char *_tileclear;
+	// values of the pending clear
+	unsigned int _clearcolor;
+	float _clearz;
+	// transient allocations per worker, [0] is the calling thread, reset by Present()
+	std::vector<FPArena *> _arenas;
+	// most arena bytes in use at once during the last presented frame
+	size_t _arenapeak;
+	// post-transform vertices of current draw, _tv[i - _tvfirst] belongs to _vb[i]
+	FPTransformedVertex *_tv;
+	int _tvfirst;
+	// vertex stage streams, grown to the largest draw and reused
+	MLVector4Stream _spos, _sclip, _sview;
+	MLVector3Stream _snormalin, _snormal;
+	// triangles set up by current draw, from _arenas[0]
+	FPTriangle *_tris;
+	int _tricount, _tricapacity;
+	// _arenas[0] position before current draw
+	FPArenaMarker _drawmark;
+
+	// render into rt, back buffer size follows the target
+	Device(FPRenderTarget *rt);
+	~Device();
+
+	// world and view are affine, the last column of their m is ignored
+	void SetTransform(TRANSFORMTYPE type, const MLMatrix4 *m);
+	void SetTransform(TRANSFORMTYPE type, const MLAffine3x4 *m);
+	void SetRenderState(FILLTYPE value);
+	void SetShadeMode(SHADETYPE value);
+	void SetSampleState(SAMPLETYPE value);
+	void SetRasterMode(RASTERTYPE value);
+	void SetPerspectiveMode(PERSPECTIVETYPE value);
+	// PERSPECTIVE_SPAN*: an interpolated attribute is at most error pixels away on screen
+	// from where it belongs, pieces of a span that would be off more are divided per pixel
+	void SetPerspectiveError(float error);
+	void SetInterpolateMode(INTERPOLATETYPE value);
+	void SetBinMode(BINTYPE value);
+	// worker threads for BIN_TILED, 0 means one per hardware thread
+	void SetWorkerCount(int count);
+	void SetClearMode(CLEARTYPE value);
+	void Clear(unsigned int color, float z);
+	void SetStreamSource(FPVertex *vb);
+	void SetIndices(int *ib);
+	// object space box around the vertices of the following draws, nullptr for none
+	// a draw whose box is outside the view is skipped before any vertex is transformed
+	void SetBounds(const MLVector3 *pMin, const MLVector3 *pMax);
+	void SetMaterial(Material *mtrl);
+	void SetLight(Light *light);
+	// bind without copying, waits if tex is still building its mips
+	void SetTexture(FPTextureResource *tex);
+	// create a resource from tex and bind it
+	void SetTexture(const Texture *tex);
+	void LightEnable(bool value);
+	// false if the object space box is outside the view of the current transforms
+	bool BoundsVisible(const MLVector3 *pMin, const MLVector3 *pMax);
+
+	// rebuild the matrices and frustum derived from the transforms if they changed
+	void UpdateTransforms();
+
+	// bake _light and _mtrl into _lu if they or the view changed
+	void UpdateLightUniforms();
+	// parameter: unit normal and unit direction to light in view
+	Color GetDiffuseColor(const MLVector3 *normal, const MLVector3 *lightdir);
+	// parameter: unit normal, unit direction to light and transformed vertex
+	Color GetSpecularColor(const MLVector3 *normal, const MLVector3 *lightdir, const MLVector4 *pV);
+	// get the final light color(emissive + amibent + diffuse + specular)
+	// parameter: transformed normal and transformed vertex
+	Color GetLightColor(const MLVector4 *pN, const MLVector4 *pV);
+
+	Color BilinearTextureSampling(const Texture *tex, float u, float v);
+	float GenerateMipMapRatio(const MLVector4 *p1, const MLVector4 *p2, const MLVector4 *p3);
+
+	// clip
+	// after projection, FP_CLIP* bits of the planes v is outside of
+	int ClipCode(const MLVector4 *v);
+	void ClipVertexInterpolation(FPClipVertex *vOut, const FPClipVertex *v1,
+		const FPClipVertex *v2, float factor);
+	// backface culling
+	// after projection division
+	bool Backface_Culling(const MLVector4 *p1, const MLVector4 *p2, const MLVector4 *p3);
+
+	void BresenhamDrawLine(const MLVector4 *p1, const MLVector4 *p2, FPRasterContext *ctx);
+	// pixels start .. end - 1 of row yIndex, left and right are on the edges
+	void DrawScanLine(const FPVertex *left, const FPVertex *right, int start, int end,
+		int yIndex, FPRasterContext *ctx);
+	// INTERPOLATE_BARYCENTRIC: same from ctx->bary
+	void DrawBarycentricScanLine(int start, int end, int yIndex, FPRasterContext *ctx);
+	// planes of depth and barycentrics and the vertex attributes of tri
+	void SetupBarycentric(const FPTriangle *tri, FPBaryInterp *bary);
+	// pick _kernels for the current states
+	void UpdateKernels();
+	// FPRasterKernels of one state combination, in FPRasterKernel.cpp
+	template<FILLTYPE Fill, SAMPLETYPE Sample, SHADETYPE Shade, bool Light, bool Divide>
+	void ShadeSpan(const FPSpanInterp *s, int x0, int x1, int y, FPRasterContext *ctx);
+	template<FILLTYPE Fill, SAMPLETYPE Sample, SHADETYPE Shade, bool Light>
+	void ShadeBarySpan(const FPBaryInterp *p, int x0, int x1, int y, FPRasterContext *ctx);
+	template<FILLTYPE Fill, SAMPLETYPE Sample, SHADETYPE Shade, bool Light>
+	void ShadeBlockRow(const FPPlaneInterp *p, int bx, int y, int mask, FPRasterContext *ctx);
+	// color of a pixel from its packed attributes, already perspective correct
+	template<FILLTYPE Fill, SAMPLETYPE Sample, SHADETYPE Shade, bool Light>
+	unsigned int ShadeFragment(const float *a, FPRasterContext *ctx);
+	void VertexInterpolation(FPVertex *vOut, const FPVertex *v1, const FPVertex *v2, float factor);
+	void VertexDivision(FPVertex *vOut, const FPVertex *v1, const FPVertex *v2, float factor);
+	void VertexAdd(FPVertex *vOut, FPVertex *step);
+	// screen space gradient of every attribute over triangle v1 v2 v3
+	void VertexGradient(FPVertex *ddx, FPVertex *ddy, const FPVertex *v1, const FPVertex *v2,
+		const FPVertex *v3);
+	// edge from v1 down to v2 at scanline y, attributes only if asked for
+	void SetupScanEdge(FPScanEdge *edge, const FPVertex *v1, const FPVertex *v2, int y,
+		bool attributes);
+	void StepScanEdge(FPScanEdge *edge, bool attributes);
+	void FillOnePrimitive(const FPVertex *v1, const FPVertex *v2, const FPVertex *v3,
+		FPRasterContext *ctx);
+	// RASTER_HALFSPACE: edge function rasterization in 8x8 blocks
+	void FillHalfSpacePrimitive(const FPTriangle *tri, FPRasterContext *ctx);
+	// transform and light _vb[first] .. _vb[first + count - 1] into out
+	void ProcessVertices(int first, int count, FPTransformedVertex *out);
+	// clip the triangle of vertices _vb[i1], _vb[i2], _vb[i3] against near, far and the guard
+	// band, after ProcessVertices. The convex polygon left is written to poly, return its
+	// vertex count, 0 if nothing of it is visible
+	int ClipPrimitive(int i1, int i2, int i3, FPClipVertex *poly);
+	// project a triangle of a clipped polygon, return false if nothing of it is visible
+	bool SetupPrimitive(const FPClipVertex *c1, const FPClipVertex *c2, const FPClipVertex *c3,
+		FPTriangle *tri);
+	// rasterize the part of tri inside ctx->clip
+	void RasterPrimitive(const FPTriangle *tri, FPRasterContext *ctx);
+	void DrawOnePrimitive(int i1, int i2, int i3);
+	// BIN_TILED: make room for TriCount triangles
+	void BeginBins(int TriCount);
+	// BIN_TILED: clip, set up and bin one triangle, flushes first if the bins are full
+	void BinOnePrimitive(int i1, int i2, int i3);
+	// BIN_TILED: rasterize all binned triangles tile by tile on the workers
+	void FlushBins();
+	// vertices of triangle i are ib[i * 3 + k], or first + i * 3 + k without ib
+	void DrawTriangles(const int *ib, int first, int TriCount);
+	void DrawPrimitive(int startIndex, int TriCount);
+	void DrawIndexedPrimitive(int startIndex, int TriCount);
+
+	// write the pending clear of the given buffers of one tile
+	void ResolveTileClear(int tx, int ty, int buffers);
+	// write the pending clears of every tile overlapping rect
+	void ResolveClear(const FPRect *rect);
+	// farthest depth in hiz square (tx, ty)
+	float GetHiZ(int tx, int ty);
+	// true if nothing at depth z or farther can pass the depth test inside rect
+	bool HiZReject(const FPRect *rect, float z);
+
+	void SetBackBuffer(int x, int y, unsigned int color);
+	void SetBackBuffer(int x, int y, unsigned int color, const FPRect *clip);
+	void Present();
+	// arena bytes needed by the last presented frame, summed over workers
+	size_t GetArenaHighWater() const;
+
+private:
+	Device(const Device &);
+	Device &operator = (const Device &);
+};
+
+// raster inner loops compiled for one combination of fill, sample, shade and lighting,
+// so they only step the attributes it uses and don't branch on state per pixel
+struct FPRasterKernels {
+	// number of attributes the kernels use
+	int count;
+	// copy them from v to a[0] .. a[count - 1]
+	void (*pack)(float *a, const FPVertex *v);
+	// depth test, shade and write pixels x0 .. x1 - 1 of row y, attributes divided by w
+	void (Device::*span)(const FPSpanInterp *s, int x0, int x1, int y, FPRasterContext *ctx);
+	// same, attributes along s are perspective correct already
+	void (Device::*spanlinear)(const FPSpanInterp *s, int x0, int x1, int y,
+		FPRasterContext *ctx);
+	// same, attributes rebuilt from the barycentrics in p
+	void (Device::*spanbary)(const FPBaryInterp *p, int x0, int x1, int y,
+		FPRasterContext *ctx);
+	// same for pixel bx + i of row y for every bit i set in mask
+	void (Device::*block)(const FPPlaneInterp *p, int bx, int y, int mask, FPRasterContext *ctx);
+};
@@ -0,0 +1,30 @@
+#ifdef _WIN32
+#include "FPGDIRenderTarget.h"
+
+FPGDIRenderTarget::FPGDIRenderTarget(HWND hwnd, int width, int height) {
+	_width = width;
+	_height = height;
+	_pitch = width;
+	_hwnd = hwnd;
+	HDC hdc = GetDC(hwnd);
+	_drawdc = CreateCompatibleDC(hdc);
+	ReleaseDC(hwnd, hdc);
+	BITMAPINFO bi = { { sizeof(BITMAPINFOHEADER), width, -height, 1, 32, BI_RGB,
+		(DWORD)(width * height * 4), 0, 0, 0, 0 } };
+	_bitmap = CreateDIBSection(_drawdc, &bi, DIB_RGB_COLORS, (void **)&_colorbuf, 0, 0);
+	_oldbitmap = (HBITMAP)SelectObject(_drawdc, _bitmap);
+}
+
+FPGDIRenderTarget::~FPGDIRenderTarget() {
+	SelectObject(_drawdc, _oldbitmap);
+	DeleteObject(_bitmap);
+	DeleteDC(_drawdc);
+}
+
+void FPGDIRenderTarget::Present() {
+	HDC hDC = GetDC(_hwnd);
+	BitBlt(hDC, 0, 0, _width, _height, _drawdc, 0, 0, SRCCOPY);
+	ReleaseDC(_hwnd, hDC);
+	_frame++;
+}
+#endif
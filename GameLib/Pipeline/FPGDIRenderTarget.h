@@ -0,0 +1,21 @@
+#pragma once
+#include <Windows.h>
+#include "FPRenderTarget.h"
+
+// win32 backend: GDI dib section blitted to the window on Present()
+class FPGDIRenderTarget : public FPRenderTarget {
+public:
+	FPGDIRenderTarget(HWND hwnd, int width, int height);
+	virtual ~FPGDIRenderTarget();
+	virtual void Present();
+
+private:
+	FPGDIRenderTarget(const FPGDIRenderTarget &);
+	FPGDIRenderTarget &operator = (const FPGDIRenderTarget &);
+	// window handle
+	HWND _hwnd;
+	// back buffer dc
+	HDC _drawdc;
+	// back buffer bitmap and the one it replaced in _drawdc
+	HBITMAP _bitmap, _oldbitmap;
+};
@@ -0,0 +1,122 @@
+#include "FPMemory.h"
+#include "../Math/MLSimd.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+void *FPAlignedAlloc(size_t size, size_t alignment) {
+#ifdef _MSC_VER
+	return _aligned_malloc(size, alignment);
+#else
+	void *p = nullptr;
+	if (posix_memalign(&p, alignment, size) != 0)
+		return nullptr;
+	return p;
+#endif
+}
+
+void FPAlignedFree(void *p) {
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+void FPFill32(unsigned int *dst, unsigned int value, size_t count) {
+	// scalar up to a vector boundary, then aligned vector stores
+#if defined(ML_SIMD_AVX)
+	const size_t align = 32;
+#elif defined(ML_SIMD_SSE2)
+	const size_t align = 16;
+#else
+	const size_t align = 4;
+#endif
+	while (count && ((size_t)dst & (align - 1))) {
+		*dst++ = value;
+		count--;
+	}
+#if defined(ML_SIMD_AVX)
+	__m256i v = _mm256_set1_epi32((int)value);
+	for (; count >= 8; count -= 8, dst += 8)
+		_mm256_store_si256((__m256i *)dst, v);
+#elif defined(ML_SIMD_SSE2)
+	__m128i v = _mm_set1_epi32((int)value);
+	for (; count >= 4; count -= 4, dst += 4)
+		_mm_store_si128((__m128i *)dst, v);
+#endif
+	while (count--)
+		*dst++ = value;
+}
+
+void FPFill32(float *dst, float value, size_t count) {
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	FPFill32((unsigned int *)dst, bits, count);
+}
+
+// FPArena
+FPArena::FPArena(size_t blocksize) : _block(0), _offset(0), _used(0), _highwater(0),
+	_blocksize(blocksize) {
+	Block block = { (char *)FPAlignedAlloc(blocksize), blocksize };
+	_blocks.push_back(block);
+}
+
+FPArena::~FPArena() {
+	for (size_t i = 0; i < _blocks.size(); i++)
+		FPAlignedFree(_blocks[i].data);
+}
+
+void *FPArena::Alloc(size_t size, size_t alignment) {
+	size_t offset = (_offset + alignment - 1) & ~(alignment - 1);
+	while (offset + size > _blocks[_block].size) {
+		// current block is full, continue in the next one that fits
+		_used += _blocks[_block].size - _offset;
+		_block++;
+		if (_block == (int)_blocks.size()) {
+			size_t blocksize = size + alignment > _blocksize ? size + alignment : _blocksize;
+			Block block = { (char *)FPAlignedAlloc(blocksize), blocksize };
+			_blocks.push_back(block);
+		}
+		_offset = 0;
+		offset = 0;
+	}
+	_used += offset + size - _offset;
+	_offset = offset + size;
+	if (_used > _highwater)
+		_highwater = _used;
+	return _blocks[_block].data + offset;
+}
+
+FPArenaMarker FPArena::GetMarker() const {
+	FPArenaMarker marker = { _block, _offset, _used };
+	return marker;
+}
+
+void FPArena::Rewind(const FPArenaMarker &marker) {
+	_block = marker.block;
+	_offset = marker.offset;
+	_used = marker.used;
+}
+
+size_t FPArena::Reset() {
+	size_t highwater = _highwater;
+	// the frame spilled into more blocks, replace them by one block that fits it all
+	if (_blocks.size() > 1) {
+		size_t total = 0;
+		for (size_t i = 0; i < _blocks.size(); i++) {
+			total += _blocks[i].size;
+			FPAlignedFree(_blocks[i].data);
+		}
+		_blocks.clear();
+		Block block = { (char *)FPAlignedAlloc(total), total };
+		_blocks.push_back(block);
+	}
+	_block = 0;
+	_offset = 0;
+	_used = 0;
+	_highwater = 0;
+	return highwater;
+}
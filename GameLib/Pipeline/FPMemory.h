@@ -0,0 +1,63 @@
+#pragma once
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+// cache line size, used as default alignment for surfaces
+const size_t FP_CACHELINE = 64;
+
+// allocate size bytes aligned to alignment(power of two)
+void *FPAlignedAlloc(size_t size, size_t alignment = FP_CACHELINE);
+
+void FPAlignedFree(void *p);
+
+// store count copies of value from dst on
+void FPFill32(unsigned int *dst, unsigned int value, size_t count);
+void FPFill32(float *dst, float value, size_t count);
+
+// position in an arena to rewind to
+struct FPArenaMarker {
+	int block;
+	size_t offset;
+	size_t used;
+};
+
+// bump allocator for transient pipeline objects
+// nothing is freed one by one: Rewind() drops everything allocated after a marker,
+// Reset() drops everything. Destructors are never run.
+class FPArena {
+public:
+	FPArena(size_t blocksize = 64 * 1024);
+	~FPArena();
+	void *Alloc(size_t size, size_t alignment = 16);
+	// count default constructed objects
+	template<class T> T *New(int count = 1) {
+		T *p = (T *)Alloc(sizeof(T) * count, alignof(T) > 16 ? alignof(T) : 16);
+		for (int i = 0; i < count; i++)
+			new (p + i) T;
+		return p;
+	}
+	FPArenaMarker GetMarker() const;
+	void Rewind(const FPArenaMarker &marker);
+	// free everything, return the high-water mark since the last reset
+	size_t Reset();
+	// bytes in use
+	size_t GetUsed() const { return _used; }
+	// most bytes in use at once since the last reset
+	size_t GetHighWater() const { return _highwater; }
+
+private:
+	FPArena(const FPArena &);
+	FPArena &operator = (const FPArena &);
+	struct Block {
+		char *data;
+		size_t size;
+	};
+	std::vector<Block> _blocks;
+	// block allocations come from and offset of its free space
+	int _block;
+	size_t _offset;
+	size_t _used;
+	size_t _highwater;
+	size_t _blocksize;
+};
@@ -0,0 +1,200 @@
+/****************************************************
+* Half-space rasterizer
+* Reference:
+* Nicolas Capens, Advanced Rasterization
+* Triangles are set up in 28.4 fixed point, so edge functions are exact
+* and a pixel on an edge shared by two triangles is filled exactly once
+* (top-left rule). Screen is walked in 8x8 blocks: blocks outside an
+* edge are rejected, blocks inside all three edges are filled without
+* testing, the rest test 4 or 8 pixels per SIMD instruction.
+*/
+
+#include "FPDevice.h"
+#include "../Math/MLSimd.h"
+
+using std::min;
+using std::max;
+
+// edge of blocks tested for trivial accept / reject, one SIMD row wide
+const int FP_BLOCKSIZE = 8;
+// a block is one hiz square, so it can be depth rejected as a whole
+static_assert(FP_BLOCKSIZE == FP_HIZSIZE, "blocks must match hiz squares");
+
+namespace {
+
+// E(x, y) = a * x + b * y + c over fixed point x, y, pixel is inside when E >= 0
+struct HalfSpaceEdge {
+	long long a, b, c;
+	// change of E for one pixel step in x and y
+	int stepx, stepy;
+#if defined(ML_SIMD_AVX2)
+	__m256i lanes;
+#elif defined(ML_SIMD_SSE2)
+	__m128i lanes0, lanes1;
+#endif
+};
+
+// edge from (x0, y0) to (x1, y1), triangle interior on its positive side
+void SetupEdge(HalfSpaceEdge *e, int x0, int y0, int x1, int y1) {
+	int dx = x1 - x0, dy = y1 - y0;
+	e->a = -dy;
+	e->b = dx;
+	e->c = (long long)dy * x0 - (long long)dx * y0;
+	// top-left rule, y points down: top edges are horizontal with interior below,
+	// left edges go up. Pixels exactly on any other edge belong to the neighbour.
+	bool topleft = dy < 0 || (dy == 0 && dx > 0);
+	if (!topleft)
+		e->c -= 1;
+	e->stepx = (int)(e->a * FP_SUBPIXEL);
+	e->stepy = (int)(e->b * FP_SUBPIXEL);
+	int s = e->stepx;
+#if defined(ML_SIMD_AVX2)
+	e->lanes = _mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s);
+#elif defined(ML_SIMD_SSE2)
+	e->lanes0 = _mm_setr_epi32(0, s, 2 * s, 3 * s);
+	e->lanes1 = _mm_setr_epi32(4 * s, 5 * s, 6 * s, 7 * s);
+#endif
+}
+
+// E at pixel (x, y)
+long long EvalEdge(const HalfSpaceEdge *e, int x, int y) {
+	return e->a * ((long long)x * FP_SUBPIXEL) + e->b * ((long long)y * FP_SUBPIXEL) + e->c;
+}
+
+// bit i set if pixel i of a block row is inside, e is E at the row's first pixel
+int EdgeRowMask(const HalfSpaceEdge *edge, int e) {
+#if defined(ML_SIMD_AVX2)
+	__m256i v = _mm256_add_epi32(_mm256_set1_epi32(e), edge->lanes);
+	__m256i in = _mm256_cmpgt_epi32(v, _mm256_set1_epi32(-1));
+	return _mm256_movemask_ps(_mm256_castsi256_ps(in));
+#elif defined(ML_SIMD_SSE2)
+	__m128i base = _mm_set1_epi32(e);
+	__m128i minus1 = _mm_set1_epi32(-1);
+	__m128i in0 = _mm_cmpgt_epi32(_mm_add_epi32(base, edge->lanes0), minus1);
+	__m128i in1 = _mm_cmpgt_epi32(_mm_add_epi32(base, edge->lanes1), minus1);
+	return _mm_movemask_ps(_mm_castsi128_ps(in0)) | (_mm_movemask_ps(_mm_castsi128_ps(in1)) << 4);
+#else
+	int mask = 0;
+	for (int i = 0; i < FP_BLOCKSIZE; i++) {
+		if (e + i * edge->stepx >= 0)
+			mask |= 1 << i;
+	}
+	return mask;
+#endif
+}
+
+}
+
+void Device::VertexGradient(FPVertex *ddx, FPVertex *ddy, const FPVertex *v1, const FPVertex *v2,
+	const FPVertex *v3) {
+	float dx1 = v2->_x - v1->_x, dy1 = v2->_y - v1->_y;
+	float dx2 = v3->_x - v1->_x, dy2 = v3->_y - v1->_y;
+	float area = dx1 * dy2 - dx2 * dy1;
+	float oneoverarea = Float_Equals(area, 0.0f) ? 0.0f : 1.0f / area;
+	// attribute a changes by (da1, da2) along the two edges leaving v1
+#define FP_GRADIENT(a) { \
+		float da1 = v2->a - v1->a, da2 = v3->a - v1->a; \
+		ddx->a = (da1 * dy2 - da2 * dy1) * oneoverarea; \
+		ddy->a = (da2 * dx1 - da1 * dx2) * oneoverarea; \
+	}
+	FP_GRADIENT(_x) FP_GRADIENT(_y) FP_GRADIENT(_z) FP_GRADIENT(_w)
+	FP_GRADIENT(_r) FP_GRADIENT(_g) FP_GRADIENT(_b)
+	FP_GRADIENT(_nx) FP_GRADIENT(_ny) FP_GRADIENT(_nz)
+	FP_GRADIENT(_u) FP_GRADIENT(_v)
+	FP_GRADIENT(_lightcolor._r) FP_GRADIENT(_lightcolor._g) FP_GRADIENT(_lightcolor._b)
+	FP_GRADIENT(_vpos.x) FP_GRADIENT(_vpos.y) FP_GRADIENT(_vpos.z)
+#undef FP_GRADIENT
+}
+
+void Device::FillHalfSpacePrimitive(const FPTriangle *tri, FPRasterContext *ctx) {
+	const FPVertex *v1 = &tri->v[0], *v2 = &tri->v[1], *v3 = &tri->v[2];
+	int x1 = FPToFixed(v1->_x), y1 = FPToFixed(v1->_y);
+	int x2 = FPToFixed(v2->_x), y2 = FPToFixed(v2->_y);
+	int x3 = FPToFixed(v3->_x), y3 = FPToFixed(v3->_y);
+	long long area = (long long)(x2 - x1) * (y3 - y1) - (long long)(x3 - x1) * (y2 - y1);
+	if (area == 0)
+		return;
+	// make the interior the positive side of all edges
+	if (area < 0) {
+		std::swap(v2, v3);
+		std::swap(x2, x3);
+		std::swap(y2, y3);
+	}
+	HalfSpaceEdge edge[3];
+	SetupEdge(&edge[0], x1, y1, x2, y2);
+	SetupEdge(&edge[1], x2, y2, x3, y3);
+	SetupEdge(&edge[2], x3, y3, x1, y1);
+	FPVertex ddx, ddy;
+	VertexGradient(&ddx, &ddy, v1, v2, v3);
+	FPPlaneInterp plane;
+	plane.x0 = v1->_x;
+	plane.y0 = v1->_y;
+	plane.z = v1->_z;
+	plane.dzdx = ddx._z;
+	plane.dzdy = ddy._z;
+	plane.w = v1->_w;
+	plane.dwdx = ddx._w;
+	plane.dwdy = ddy._w;
+	_kernels->pack(plane.a, v1);
+	_kernels->pack(plane.dadx, &ddx);
+	_kernels->pack(plane.dady, &ddy);
+
+	// pixels whose sample point can be inside, clipped to the raster rect
+	int minx = max((min(x1, min(x2, x3)) + FP_SUBPIXEL - 1) >> FP_SUBPIXEL_BITS, ctx->clip.x0);
+	int miny = max((min(y1, min(y2, y3)) + FP_SUBPIXEL - 1) >> FP_SUBPIXEL_BITS, ctx->clip.y0);
+	int maxx = min((max(x1, max(x2, x3)) >> FP_SUBPIXEL_BITS) + 1, ctx->clip.x1);
+	int maxy = min((max(y1, max(y2, y3)) >> FP_SUBPIXEL_BITS) + 1, ctx->clip.y1);
+	if (minx >= maxx || miny >= maxy)
+		return;
+
+	const int last = FP_BLOCKSIZE - 1;
+	for (int by = miny & ~last; by < maxy; by += FP_BLOCKSIZE) {
+		int rowfirst = max(by, miny) - by;
+		int rowlast = min(by + FP_BLOCKSIZE, maxy) - by;
+		for (int bx = minx & ~last; bx < maxx; bx += FP_BLOCKSIZE) {
+			// E at the block's first pixel of every edge that crosses the block
+			int blocke[3];
+			int partial[3];
+			int partialcount = 0;
+			bool reject = false;
+			for (int i = 0; i < 3; i++) {
+				long long e = EvalEdge(&edge[i], bx, by);
+				long long emin = e + min(0, last * edge[i].stepx) + min(0, last * edge[i].stepy);
+				long long emax = e + max(0, last * edge[i].stepx) + max(0, last * edge[i].stepy);
+				if (emax < 0) {
+					reject = true;
+					break;
+				}
+				if (emin < 0) {
+					// block straddles the edge, so e is small enough for 32 bit lanes
+					blocke[partialcount] = (int)e;
+					partial[partialcount++] = i;
+				}
+			}
+			if (reject)
+				continue;
+			// z is planar, so the nearest one in the block is at a corner
+			float zcorner = v1->_z + ddx._z * (bx - v1->_x) + ddy._z * (by - v1->_y);
+			float zmin = zcorner + min(0.0f, ddx._z * last) + min(0.0f, ddy._z * last);
+			if (zmin >= GetHiZ(bx / FP_HIZSIZE, by / FP_HIZSIZE))
+				continue;
+			int colfirst = max(bx, minx) - bx;
+			int collast = min(bx + FP_BLOCKSIZE, maxx) - bx;
+			int clipmask = ((1 << collast) - 1) & ~((1 << colfirst) - 1);
+			for (int r = 0; r < FP_BLOCKSIZE; r++) {
+				if (r < rowfirst || r >= rowlast) {
+					for (int i = 0; i < partialcount; i++)
+						blocke[i] += edge[partial[i]].stepy;
+					continue;
+				}
+				int mask = clipmask;
+				for (int i = 0; i < partialcount; i++) {
+					mask &= EdgeRowMask(&edge[partial[i]], blocke[i]);
+					blocke[i] += edge[partial[i]].stepy;
+				}
+				if (mask)
+					(this->*_kernels->block)(&plane, bx, by + r, mask, ctx);
+			}
+		}
+	}
+}
@@ -0,0 +1,225 @@
+/****************************************************
+* Raster kernels
+* The per pixel work of both rasterizers, compiled once for every
+* combination of fill, sample, shade and lighting. A kernel only carries
+* the attributes its combination reads, packed back to back, and all
+* state tests are resolved at compile time. UpdateKernels() picks the
+* table entry once per draw.
+*/
+
+#include "FPDevice.h"
+
+using std::min;
+using std::max;
+
+namespace {
+
+// where the attributes a state combination reads are in the packed array
+template<FILLTYPE Fill, SHADETYPE Shade, bool Light>
+struct FPInterpLayout {
+	static const bool HasColor = Fill == FILL_COLOR;
+	static const bool HasTex = Fill == FILL_TEXTURE;
+	static const bool HasLightColor = Light && Shade == SHADE_GOURAUD;
+	static const bool HasNormal = Light && Shade == SHADE_PHONG;
+	static const int RGB = 0;
+	static const int UV = RGB + (HasColor ? 3 : 0);
+	static const int LIGHTCOLOR = UV + (HasTex ? 2 : 0);
+	static const int NORMAL = LIGHTCOLOR + (HasLightColor ? 3 : 0);
+	static const int VPOS = NORMAL + (HasNormal ? 3 : 0);
+	static const int COUNT = VPOS + (HasNormal ? 3 : 0);
+	static_assert(COUNT <= FP_MAXINTERP, "FP_MAXINTERP too small");
+
+	static void Pack(float *a, const FPVertex *v) {
+		if (HasColor) {
+			a[RGB] = v->_r;
+			a[RGB + 1] = v->_g;
+			a[RGB + 2] = v->_b;
+		}
+		if (HasTex) {
+			a[UV] = v->_u;
+			a[UV + 1] = v->_v;
+		}
+		if (HasLightColor) {
+			a[LIGHTCOLOR] = v->_lightcolor._r;
+			a[LIGHTCOLOR + 1] = v->_lightcolor._g;
+			a[LIGHTCOLOR + 2] = v->_lightcolor._b;
+		}
+		if (HasNormal) {
+			a[NORMAL] = v->_nx;
+			a[NORMAL + 1] = v->_ny;
+			a[NORMAL + 2] = v->_nz;
+			a[VPOS] = v->_vpos.x;
+			a[VPOS + 1] = v->_vpos.y;
+			a[VPOS + 2] = v->_vpos.z;
+		}
+	}
+};
+
+}
+
+template<FILLTYPE Fill, SAMPLETYPE Sample, SHADETYPE Shade, bool Light>
+unsigned int Device::ShadeFragment(const float *a, FPRasterContext *ctx) {
+	typedef FPInterpLayout<Fill, Shade, Light> Layout;
+	Color vertexcolor;
+	if (Fill == FILL_COLOR)
+		vertexcolor = Color(a[Layout::RGB], a[Layout::RGB + 1], a[Layout::RGB + 2]);
+	else if (Sample == SAMPLE_POINT) {
+		float u = a[Layout::UV], v = a[Layout::UV + 1];
+		int x = (int)((_tex->_width - 1) * max(0.0f, min(u, 1.0f)));
+		int y = (int)((_tex->_height - 1) * max(0.0f, min(v, 1.0f)));
+		vertexcolor = _tex->GetTexel(x, y);
+	}
+	else if (Sample == SAMPLE_LINEAR)
+		vertexcolor = BilinearTextureSampling(_tex, a[Layout::UV], a[Layout::UV + 1]);
+	else {
+		float mipratio = ctx->tri->mipratio;
+		int down = max(0, min((int)floorf(mipratio), _LOD - 1));
+		int up = max(0, min((int)ceilf(mipratio), _LOD - 1));
+		float weight = mipratio - down;
+		Color downcolor = BilinearTextureSampling(_tex + down, a[Layout::UV], a[Layout::UV + 1]);
+		Color upcolor = BilinearTextureSampling(_tex + up, a[Layout::UV], a[Layout::UV + 1]);
+		vertexcolor = downcolor * (1.0f - weight) + upcolor * weight;
+	}
+	if (!Light)
+		return vertexcolor.ToUINT();
+	Color lightcolor;
+	if (Shade == SHADE_GOURAUD) {
+		lightcolor = Color(a[Layout::LIGHTCOLOR], a[Layout::LIGHTCOLOR + 1],
+			a[Layout::LIGHTCOLOR + 2]);
+	}
+	else {
+		MLVector4 fragN(a[Layout::NORMAL], a[Layout::NORMAL + 1], a[Layout::NORMAL + 2], 0.0f);
+		MLVector4 fragV(a[Layout::VPOS], a[Layout::VPOS + 1], a[Layout::VPOS + 2], 1.0f);
+		lightcolor = GetLightColor(&fragN, &fragV);
+	}
+	return (vertexcolor * lightcolor).ToUINT();
+}
+
+template<FILLTYPE Fill, SAMPLETYPE Sample, SHADETYPE Shade, bool Light, bool Divide>
+void Device::ShadeSpan(const FPSpanInterp *s, int x0, int x1, int y, FPRasterContext *ctx) {
+	const int count = FPInterpLayout<Fill, Shade, Light>::COUNT;
+	assert(x0 >= 0 && x1 <= _width);
+	float *depth = &_zbuf[y * _zpitch];
+	unsigned char *hizdirty = &_hizdirty[(y / FP_HIZSIZE) * _hizpitch];
+	unsigned int *color = &_backbuf[y * _pitch];
+	float a[FP_MAXINTERP];
+	for (int x = x0; x < x1; x++) {
+		float z = s->z + s->dz * (float)(x - s->zorigin);
+		if (!(z < depth[x]))
+			continue;
+		depth[x] = z;
+		hizdirty[x / FP_HIZSIZE] = 1;
+		float n = (float)(x - s->origin);
+		if (Divide) {
+			float oneoverw = 1.0f / (s->w + s->dw * n);
+			for (int i = 0; i < count; i++)
+				a[i] = (s->a[i] + s->da[i] * n) * oneoverw;
+		}
+		else {
+			for (int i = 0; i < count; i++)
+				a[i] = s->a[i] + s->da[i] * n;
+		}
+		color[x] = ShadeFragment<Fill, Sample, Shade, Light>(a, ctx);
+	}
+}
+
+template<FILLTYPE Fill, SAMPLETYPE Sample, SHADETYPE Shade, bool Light>
+void Device::ShadeBarySpan(const FPBaryInterp *p, int x0, int x1, int y, FPRasterContext *ctx) {
+	const int count = FPInterpLayout<Fill, Shade, Light>::COUNT;
+	assert(x0 >= 0 && x1 <= _width);
+	float *depth = &_zbuf[y * _zpitch];
+	unsigned char *hizdirty = &_hizdirty[(y / FP_HIZSIZE) * _hizpitch];
+	unsigned int *color = &_backbuf[y * _pitch];
+	// planes at x = p->x0 on this row, DrawBarycentricScanLine gets z the same way
+	// locals, the buffer writes could alias p otherwise
+	float dy = y - p->y0, x0f = p->x0;
+	float zrow = p->z + p->dzdy * dy, dzdx = p->dzdx;
+	float wrow = p->w + p->dwdy * dy, dwdx = p->dwdx;
+	float b1row = p->b1 + p->db1dy * dy, db1dx = p->db1dx;
+	float b2row = p->b2 + p->db2dy * dy, db2dx = p->db2dx;
+	float a0[FP_MAXINTERP], da1[FP_MAXINTERP], da2[FP_MAXINTERP];
+	for (int i = 0; i < count; i++) {
+		a0[i] = p->a[i];
+		da1[i] = p->da1[i];
+		da2[i] = p->da2[i];
+	}
+	float a[FP_MAXINTERP];
+	for (int x = x0; x < x1; x++) {
+		float dx = x - x0f;
+		float z = zrow + dzdx * dx;
+		if (!(z < depth[x]))
+			continue;
+		depth[x] = z;
+		hizdirty[x / FP_HIZSIZE] = 1;
+		float oneoverw = 1.0f / (wrow + dwdx * dx);
+		float b1 = (b1row + db1dx * dx) * oneoverw;
+		float b2 = (b2row + db2dx * dx) * oneoverw;
+		for (int i = 0; i < count; i++)
+			a[i] = a0[i] + da1[i] * b1 + da2[i] * b2;
+		color[x] = ShadeFragment<Fill, Sample, Shade, Light>(a, ctx);
+	}
+}
+
+template<FILLTYPE Fill, SAMPLETYPE Sample, SHADETYPE Shade, bool Light>
+void Device::ShadeBlockRow(const FPPlaneInterp *p, int bx, int y, int mask,
+	FPRasterContext *ctx) {
+	const int count = FPInterpLayout<Fill, Shade, Light>::COUNT;
+	float *depth = &_zbuf[y * _zpitch];
+	unsigned char *hizdirty = &_hizdirty[(y / FP_HIZSIZE) * _hizpitch];
+	unsigned int *color = &_backbuf[y * _pitch];
+	float dy = y - p->y0;
+	float a[FP_MAXINTERP];
+	while (mask) {
+		int lane = 0;
+		while (!(mask & (1 << lane)))
+			lane++;
+		mask &= mask - 1;
+		int x = bx + lane;
+		assert(x >= 0 && x < _width);
+		float dx = x - p->x0;
+		float z = p->z + p->dzdx * dx + p->dzdy * dy;
+		if (!(z < depth[x]))
+			continue;
+		depth[x] = z;
+		hizdirty[x / FP_HIZSIZE] = 1;
+		float oneoverw = 1.0f / (p->w + p->dwdx * dx + p->dwdy * dy);
+		for (int i = 0; i < count; i++)
+			a[i] = (p->a[i] + p->dadx[i] * dx + p->dady[i] * dy) * oneoverw;
+		color[x] = ShadeFragment<Fill, Sample, Shade, Light>(a, ctx);
+	}
+}
+
+#define FP_KERNELS(fill, sample, shade, light) { \
+		FPInterpLayout<fill, shade, light>::COUNT, \
+		&FPInterpLayout<fill, shade, light>::Pack, \
+		&Device::ShadeSpan<fill, sample, shade, light, true>, \
+		&Device::ShadeSpan<fill, sample, shade, light, false>, \
+		&Device::ShadeBarySpan<fill, sample, shade, light>, \
+		&Device::ShadeBlockRow<fill, sample, shade, light> }
+// [unlit, gouraud, phong], without lighting the shade mode doesn't matter
+#define FP_KERNELS_LIGHT(fill, sample) { \
+		FP_KERNELS(fill, sample, SHADE_GOURAUD, false), \
+		FP_KERNELS(fill, sample, SHADE_GOURAUD, true), \
+		FP_KERNELS(fill, sample, SHADE_PHONG, true) }
+
+void Device::UpdateKernels() {
+	// color fill doesn't sample
+	static const FPRasterKernels color[3] = FP_KERNELS_LIGHT(FILL_COLOR, SAMPLE_POINT);
+	static const FPRasterKernels texture[3][3] = {
+		FP_KERNELS_LIGHT(FILL_TEXTURE, SAMPLE_POINT),
+		FP_KERNELS_LIGHT(FILL_TEXTURE, SAMPLE_LINEAR),
+		FP_KERNELS_LIGHT(FILL_TEXTURE, SAMPLE_MIPMAP),
+	};
+	int light = !_lightenable ? 0 : _shade == SHADE_PHONG ? 2 : 1;
+	if (_rstate == FILL_COLOR)
+		_kernels = &color[light];
+	else if (_rstate == FILL_TEXTURE) {
+		int sample = _sample == SAMPLE_LINEAR ? 1 : _sample == SAMPLE_MIPMAP ? 2 : 0;
+		_kernels = &texture[sample][light];
+	}
+	else
+		_kernels = nullptr;
+}
+
+#undef FP_KERNELS_LIGHT
+#undef FP_KERNELS
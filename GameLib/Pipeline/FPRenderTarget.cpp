@@ -0,0 +1,61 @@
+#include "FPRenderTarget.h"
+#include "FPMemory.h"
+#include <cstdio>
+#include <string.h>
+
+// FPMemoryRenderTarget
+FPMemoryRenderTarget::FPMemoryRenderTarget(int width, int height) {
+	_width = width;
+	_height = height;
+	// keep every row cache line aligned
+	int align = (int)(FP_CACHELINE / sizeof(unsigned int));
+	_pitch = (width + align - 1) / align * align;
+	_colorbuf = (unsigned int *)FPAlignedAlloc(sizeof(unsigned int) * _pitch * _height);
+	memset(_colorbuf, 0, sizeof(unsigned int) * _pitch * _height);
+}
+
+FPMemoryRenderTarget::~FPMemoryRenderTarget() {
+	FPAlignedFree(_colorbuf);
+}
+
+void FPMemoryRenderTarget::Present() {
+	_frame++;
+}
+
+// FPImageSinkRenderTarget
+FPImageSinkRenderTarget::FPImageSinkRenderTarget(int width, int height, FPImageSink sink,
+	void *user) : FPMemoryRenderTarget(width, height), _sink(sink), _user(user) {
+}
+
+void FPImageSinkRenderTarget::Present() {
+	if (_sink)
+		_sink(_colorbuf, _width, _height, _pitch, _frame, _user);
+	_frame++;
+}
+
+bool FPWritePPM(const char *filename, const unsigned int *pixels, int width, int height,
+	int pitch) {
+	FILE *fp = fopen(filename, "wb");
+	if (!fp)
+		return false;
+	fprintf(fp, "P6\n%d %d\n255\n", width, height);
+	unsigned char *row = new unsigned char[width * 3];
+	for (int y = 0; y < height; y++) {
+		const unsigned int *src = pixels + y * pitch;
+		for (int x = 0; x < width; x++) {
+			row[x * 3] = (src[x] >> 16) & 0xff;
+			row[x * 3 + 1] = (src[x] >> 8) & 0xff;
+			row[x * 3 + 2] = src[x] & 0xff;
+		}
+		fwrite(row, 1, width * 3, fp);
+	}
+	delete[] row;
+	return fclose(fp) == 0;
+}
+
+void FPPPMSequenceSink(const unsigned int *pixels, int width, int height, int pitch, int frame,
+	void *user) {
+	char filename[260];
+	snprintf(filename, sizeof(filename), (const char *)user, frame);
+	FPWritePPM(filename, pixels, width, height, pitch);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+/****************************************************
+* Render target: where the device rasterizes to and what
+* Present() does with the finished frame.
+* Color buffer is 32 bit XRGB, row-major, pitch in pixels.
+*/
+
+class FPRenderTarget {
+public:
+	virtual ~FPRenderTarget() {}
+	int GetWidth() const { return _width; }
+	int GetHeight() const { return _height; }
+	// pixels per row of color buffer
+	int GetPitch() const { return _pitch; }
+	unsigned int *GetColorBuffer() { return _colorbuf; }
+	// number of frames presented so far
+	int GetFrameCount() const { return _frame; }
+	// hand the finished frame to the backend
+	virtual void Present() = 0;
+
+protected:
+	FPRenderTarget() : _width(0), _height(0), _pitch(0), _colorbuf(nullptr), _frame(0) {}
+	int _width, _height;
+	int _pitch;
+	unsigned int *_colorbuf;
+	int _frame;
+};
+
+// plain aligned memory surface, Present() only counts frames
+class FPMemoryRenderTarget : public FPRenderTarget {
+public:
+	FPMemoryRenderTarget(int width, int height);
+	virtual ~FPMemoryRenderTarget();
+	virtual void Present();
+
+private:
+	FPMemoryRenderTarget(const FPMemoryRenderTarget &);
+	FPMemoryRenderTarget &operator = (const FPMemoryRenderTarget &);
+};
+
+// called with every presented frame
+typedef void (*FPImageSink)(const unsigned int *pixels, int width, int height, int pitch, int frame,
+	void *user);
+
+// memory surface that forwards each presented frame to an image sink
+class FPImageSinkRenderTarget : public FPMemoryRenderTarget {
+public:
+	FPImageSinkRenderTarget(int width, int height, FPImageSink sink, void *user);
+	virtual void Present();
+
+private:
+	FPImageSink _sink;
+	void *_user;
+};
+
+// write 32 bit XRGB pixels as binary ppm
+bool FPWritePPM(const char *filename, const unsigned int *pixels, int width, int height, int pitch);
+
+// image sink writing one ppm per frame
+// user: printf style file name pattern taking frame index, e.g. "frame%04d.ppm"
+void FPPPMSequenceSink(const unsigned int *pixels, int width, int height, int pitch, int frame,
+	void *user);
@@ -0,0 +1,113 @@
+#include "FPTexture.h"
+#include "FPMemory.h"
+#include <string.h>
+
+Texture::Texture() : _width(0), _height(0), _format(TEXFMT_RGBA8), _tilesx(0), _texels(nullptr) {
+}
+
+Texture::Texture(int width, int height, TEXFORMAT format) : _texels(nullptr) {
+	_width = width;
+	_height = height;
+	_format = format;
+	_tilesx = (width + FP_TEXTILE - 1) / FP_TEXTILE;
+	_texels = FPAlignedAlloc(GetSize());
+	memset(_texels, 0, GetSize());
+}
+
+Texture::Texture(const Texture &tex) : _texels(nullptr) {
+	*this = tex;
+}
+
+Texture::~Texture() {
+	FPAlignedFree(_texels);
+}
+
+Texture &Texture::operator = (const Texture &tex) {
+	if (this == &tex)
+		return *this;
+	FPAlignedFree(_texels);
+	_width = tex._width;
+	_height = tex._height;
+	_format = tex._format;
+	_tilesx = tex._tilesx;
+	_texels = nullptr;
+	if (tex._texels) {
+		_texels = FPAlignedAlloc(GetSize());
+		memcpy(_texels, tex._texels, GetSize());
+	}
+	return *this;
+}
+
+void Texture::SetTexel(int x, int y, const Color &c) {
+	int i = TexelIndex(x, y);
+	if (_format == TEXFMT_RGBA8) {
+		((unsigned int *)_texels)[i] = 0xff000000 | c.ToUINT();
+		return;
+	}
+	float *t = (float *)_texels + i * 4;
+	t[0] = c._r;
+	t[1] = c._g;
+	t[2] = c._b;
+	t[3] = 1.0f;
+}
+
+size_t Texture::GetSize() const {
+	size_t texel = _format == TEXFMT_RGBA8 ? 4 : 16;
+	size_t tilesy = (_height + FP_TEXTILE - 1) / FP_TEXTILE;
+	return texel * _tilesx * tilesy * FP_TEXTILE * FP_TEXTILE;
+}
+
+// FPTextureResource
+FPTextureResource *FPTextureResource::Create(const Texture &image, bool async) {
+	FPTextureResource *res = new FPTextureResource(image);
+	if (async)
+		res->_built = std::async(std::launch::async, [res]() { res->BuildMipmaps(); }).share();
+	else
+		res->BuildMipmaps();
+	return res;
+}
+
+FPTextureResource::FPTextureResource(const Texture &image) : _refs(1) {
+	_count = 1;
+	int size = image._width < image._height ? image._width : image._height;
+	while ((size >>= 1) > 0)
+		_count++;
+	_levels = new Texture[_count];
+	_levels[0] = image;
+}
+
+FPTextureResource::~FPTextureResource() {
+	Wait();
+	delete[] _levels;
+}
+
+void FPTextureResource::AddRef() {
+	_refs++;
+}
+
+void FPTextureResource::Release() {
+	if (--_refs == 0)
+		delete this;
+}
+
+void FPTextureResource::Wait() const {
+	if (_built.valid())
+		_built.wait();
+}
+
+void FPTextureResource::BuildMipmaps() {
+	for (int i = 1; i < _count; i++) {
+		const Texture &prev = _levels[i - 1];
+		_levels[i] = Texture(prev._width >> 1, prev._height >> 1, prev._format);
+		for (int y = 0; y < _levels[i]._height; y++) {
+			for (int x = 0; x < _levels[i]._width; x++) {
+				// sampling from previous:(2x, 2y), (2x+1, 2y), (2x, 2y+1), (2x+1, 2y+1)
+				Color c1 = prev.GetTexel(x << 1, y << 1);
+				Color c2 = prev.GetTexel((x << 1) + 1, y << 1);
+				Color c3 = prev.GetTexel(x << 1, (y << 1) + 1);
+				Color c4 = prev.GetTexel((x << 1) + 1, (y << 1) + 1);
+				_levels[i].SetTexel(x, y, (c1 + c2 + c3 + c4) * 0.25f);
+			}
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "FPTypes.h"
+#include <atomic>
+#include <future>
+
+/****************************************************
+* Texture storage: one allocation of packed texels.
+* Texels are grouped in FP_TEXTILE x FP_TEXTILE tiles, tiles are
+* row major and texels inside a tile are in Morton (Z) order, so
+* the 2x2 footprint of a bilinear fetch is nearly always in one
+* cache line and a small screen area touches few lines.
+*/
+
+enum TEXFORMAT {
+	// 8 bit per channel, one 0xAARRGGBB word per texel
+	TEXFMT_RGBA8 = 1,
+	// float per channel
+	TEXFMT_RGBA32F = 2,
+};
+
+// tile edge in texels
+const int FP_TEXTILE_BITS = 3;
+const int FP_TEXTILE = 1 << FP_TEXTILE_BITS;
+
+struct Texture {
+	int _width, _height;
+	TEXFORMAT _format;
+	// tiles per row
+	int _tilesx;
+	// texels in tile order
+	void *_texels;
+
+	Texture();
+	Texture(int width, int height, TEXFORMAT format = TEXFMT_RGBA8);
+	Texture(const Texture &tex);
+	~Texture();
+	Texture &operator = (const Texture &tex);
+
+	// position of texel (x, y) in _texels
+	int TexelIndex(int x, int y) const {
+		// spread the low bits of x to even and of y to odd bit positions
+		int mx = (x & 1) | ((x & 2) << 1) | ((x & 4) << 2);
+		int my = ((y & 1) << 1) | ((y & 2) << 2) | ((y & 4) << 3);
+		int tile = (y >> FP_TEXTILE_BITS) * _tilesx + (x >> FP_TEXTILE_BITS);
+		return (tile << (2 * FP_TEXTILE_BITS)) | my | mx;
+	}
+	Color GetTexel(int x, int y) const {
+		int i = TexelIndex(x, y);
+		if (_format == TEXFMT_RGBA8) {
+			unsigned int t = ((const unsigned int *)_texels)[i];
+			const float scale = 1.0f / 255.0f;
+			return Color(((t >> 16) & 0xff) * scale, ((t >> 8) & 0xff) * scale, (t & 0xff) * scale);
+		}
+		const float *t = (const float *)_texels + i * 4;
+		return Color(t[0], t[1], t[2]);
+	}
+	void SetTexel(int x, int y, const Color &c);
+	// bytes of texel storage
+	size_t GetSize() const;
+};
+
+// immutable texture with its whole mip chain, shared by reference count
+// level i is level i - 1 box filtered to half size, down to 1 texel on the short side
+class FPTextureResource {
+public:
+	// copy image and build the mips now, or on a background thread when async
+	// the caller holds the one reference
+	static FPTextureResource *Create(const Texture &image, bool async = false);
+	void AddRef();
+	// delete on last reference
+	void Release();
+	// block until the mips are built
+	void Wait() const;
+	// valid after Wait()
+	int GetLevelCount() const { return _count; }
+	const Texture *GetLevels() const { return _levels; }
+
+private:
+	FPTextureResource(const Texture &image);
+	~FPTextureResource();
+	FPTextureResource(const FPTextureResource &);
+	FPTextureResource &operator = (const FPTextureResource &);
+	void BuildMipmaps();
+
+	std::atomic<int> _refs;
+	Texture *_levels;
+	int _count;
+	// set when built on a background thread
+	std::shared_future<void> _built;
+};
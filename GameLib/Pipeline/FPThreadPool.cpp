@@ -0,0 +1,70 @@
+#include "FPThreadPool.h"
+
+FPThreadPool::FPThreadPool(int threads) : _job(nullptr), _count(0), _next(0), _busy(0),
+	_generation(0), _quit(false) {
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+	if (threads <= 0)
+		threads = 1;
+	for (int i = 1; i < threads; i++)
+		_threads.push_back(std::thread(&FPThreadPool::WorkerLoop, this, i));
+}
+
+FPThreadPool::~FPThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_wake.notify_all();
+	for (size_t i = 0; i < _threads.size(); i++)
+		_threads[i].join();
+}
+
+void FPThreadPool::Run(int count, const std::function<void(int, int)> &job) {
+	if (count <= 0)
+		return;
+	if (_threads.empty() || count == 1) {
+		for (int i = 0; i < count; i++)
+			job(i, 0);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_job = &job;
+		_count = count;
+		_next = 0;
+		_busy = (int)_threads.size();
+		_generation++;
+	}
+	_wake.notify_all();
+	RunJobs(0);
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done.wait(lock, [this] { return _busy == 0; });
+	_job = nullptr;
+}
+
+void FPThreadPool::WorkerLoop(int worker) {
+	unsigned int generation = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [&] { return _quit || _generation != generation; });
+			if (_quit)
+				return;
+			generation = _generation;
+		}
+		RunJobs(worker);
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (--_busy == 0)
+			_done.notify_one();
+	}
+}
+
+void FPThreadPool::RunJobs(int worker) {
+	for (;;) {
+		int index = _next.fetch_add(1);
+		if (index >= _count)
+			return;
+		(*_job)(index, worker);
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads running indexed jobs
+class FPThreadPool {
+public:
+	// threads: total workers including the calling thread, 0 means one per hardware thread
+	FPThreadPool(int threads = 0);
+	~FPThreadPool();
+	int GetThreadCount() const { return (int)_threads.size() + 1; }
+	// run job(index, worker) for every index in [0, count) and wait for all of them
+	// the calling thread works as worker 0, worker ids are below GetThreadCount()
+	void Run(int count, const std::function<void(int, int)> &job);
+
+private:
+	FPThreadPool(const FPThreadPool &);
+	FPThreadPool &operator = (const FPThreadPool &);
+	void WorkerLoop(int worker);
+	void RunJobs(int worker);
+
+	std::vector<std::thread> _threads;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	const std::function<void(int, int)> *_job;
+	int _count;
+	std::atomic<int> _next;
+	// workers still running the current batch
+	int _busy;
+	// bumped for every batch so sleeping workers can tell a new one arrived
+	unsigned int _generation;
+	bool _quit;
+};
@@ -0,0 +1,170 @@
+#pragma once
+#include <algorithm>
+#include <assert.h>
+#include "../Math/MLUtility.h"
+
+enum TRANSFORMTYPE
+{
+	TRANSFORM_WORLD = 1,
+	TRANSFORM_VIEW = 2,
+	TRANSFORM_PROJECTION = 4,
+};
+
+enum FILLTYPE {
+	FILL_WIREFRAME = 1,
+	FILL_COLOR = 2,
+	FILL_TEXTURE = 4,
+};
+
+enum LIGHTTYPE {
+	LIGHT_POINT = 1,
+	LIGHT_SPOT = 2,
+	LIGHT_DIRECTIONAL = 4,
+};
+
+enum SHADETYPE {
+	SHADE_GOURAUD = 1,
+	SHADE_PHONG = 2,
+};
+
+enum SAMPLETYPE {
+	SAMPLE_POINT = 1,
+	SAMPLE_LINEAR = 2,
+	SAMPLE_MIPMAP = 4,
+};
+
+enum RASTERTYPE {
+	// split into flat top / flat bottom halves and fill scanline by scanline
+	RASTER_SCANLINE = 1,
+	// edge functions over 8x8 blocks with top-left fill rule
+	RASTER_HALFSPACE = 2,
+};
+
+enum PERSPECTIVETYPE {
+	// divide attributes by w at every pixel
+	PERSPECTIVE_EXACT = 1,
+	// RASTER_SCANLINE: divide at every 8th or 16th pixel of a span and interpolate linearly
+	// between, pieces where that is off by more than the perspective error are still exact
+	PERSPECTIVE_SPAN8 = 2,
+	PERSPECTIVE_SPAN16 = 3,
+};
+
+enum INTERPOLATETYPE {
+	// RASTER_SCANLINE: step every attribute along the edges and spans
+	INTERPOLATE_SPAN = 1,
+	// RASTER_SCANLINE: step only depth and barycentrics, attributes are rebuilt from the
+	// triangle's vertices for pixels that pass the depth test, always perspective correct
+	INTERPOLATE_BARYCENTRIC = 2,
+};
+
+enum BINTYPE {
+	// rasterize every triangle right after setup on the calling thread
+	BIN_NONE = 1,
+	// set up a whole draw, bin triangles into screen tiles and rasterize tiles in parallel
+	BIN_TILED = 2,
+};
+
+enum CLEARTYPE {
+	// write the whole color and depth buffer in Clear()
+	CLEAR_IMMEDIATE = 1,
+	// only mark tiles cleared, a tile is written when first rasterized into
+	// and untouched tiles get their color at Present()
+	CLEAR_DEFERRED = 2,
+};
+
+struct Color {
+	float _r, _g, _b;
+	Color() {}
+	constexpr Color(float r, float g, float b) : _r(r), _g(g), _b(b) {}
+	Color operator * (const Color &rhs) const {
+		Color c;
+		c._r = this->_r * rhs._r;
+		c._g = this->_g * rhs._g;
+		c._b = this->_b * rhs._b;
+		return c;
+	}
+	Color operator * (float rhs) const {
+		Color c;
+		c._r = this->_r * rhs;
+		c._g = this->_g * rhs;
+		c._b = this->_b * rhs;
+		return c;
+	}
+	Color operator + (const Color &rhs) const {
+		Color c;
+		c._r = this->_r + rhs._r;
+		c._g = this->_g + rhs._g;
+		c._b = this->_b + rhs._b;
+		return c;
+	}
+	unsigned int ToUINT() const {
+		int r = (int)(_r * 255.0f);
+		int g = (int)(_g * 255.0f);
+		int b = (int)(_b * 255.0f);
+		r = std::max(0, std::min(r, 255));
+		g = std::max(0, std::min(g, 255));
+		b = std::max(0, std::min(b, 255));
+		unsigned int color = (r << 16) | (g << 8) | b;
+		assert(r >= 0 && g >= 0 && b >= 0);
+		return color;
+	}
+};
+
+struct FPVertex {
+	// position
+	float _x, _y, _z, _w;
+	// color
+	float _r, _g, _b;
+	// normal
+	float _nx, _ny, _nz;
+	// texture
+	float _u, _v;
+	// light color
+	Color _lightcolor;
+	// position in view
+	MLVector3 _vpos;
+	// constructor
+	FPVertex() {}
+	// the others are constant expressions, components not given are zero
+	// XYZ
+	constexpr FPVertex(float x, float y, float z)
+		: FPVertex(x, y, z, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f) {}
+	// XYZ | COLOR
+	constexpr FPVertex(float x, float y, float z, float r, float g, float b)
+		: FPVertex(x, y, z, r, g, b, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f) {}
+	// XYZ | COLOR | NORMAL
+	constexpr FPVertex(float x, float y, float z, float r, float g, float b, float nx, float ny,
+		float nz) : FPVertex(x, y, z, r, g, b, nx, ny, nz, 0.0f, 0.0f) {}
+	// XYZ | NORMAL | TEX
+	constexpr FPVertex(float x, float y, float z, float nx, float ny, float nz, float u, float v)
+		: FPVertex(x, y, z, 0.0f, 0.0f, 0.0f, nx, ny, nz, u, v) {}
+	// XYZ | COLOR | NORMAL | TEX
+	constexpr FPVertex(float x, float y, float z, float r, float g, float b, float nx, float ny,
+		float nz, float u, float v)
+		: _x(x), _y(y), _z(z), _w(1.0f), _r(r), _g(g), _b(b), _nx(nx), _ny(ny), _nz(nz), _u(u),
+		_v(v), _lightcolor(0.0f, 0.0f, 0.0f), _vpos(0.0f, 0.0f, 0.0f) {}
+};
+
+struct Material {
+	Color Diffuse;
+	Color Ambient;
+	Color Specular;
+	Color Emissive;
+	float Power;
+};
+
+struct Light {
+	LIGHTTYPE Type;
+	Color Diffiuse;
+	Color Ambient;
+	Color Specular;
+	MLVector3 Position;
+	MLVector3 Direction;
+	float Range;
+	float Falloff;
+	float Attenuation0;
+	float Attenuation1;
+	float Attenuation2;
+	float Theta;
+	float Phi;
+};
@@ -0,0 +1,676 @@
+/****************************************************
+* Math library microbenchmark
+* Times the functions of MLUtility.h and the vector and matrix
+* operators over batches of random inputs, best of a few trials.
+* Prints a table, with a file argument also writes it as CSV:
+* name,batch,simd,ns_per_op,mops_per_s
+* MathBench -verify checks the SIMD kernels against scalar references
+* instead and exits with 1 on a mismatch.
+*/
+
+#include "Math/MLUtility.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+
+namespace {
+
+// inputs of one operation fit in L1, L2 and only in memory
+const int BATCHES[] = { 64, 4096, 65536 };
+const int MAXBATCH = 65536;
+// a trial repeats the batch until it took this long
+const double TRIALSECONDS = 0.005;
+const int TRIALS = 3;
+
+const char *SimdName() {
+#if defined(ML_SIMD_AVX2)
+	return "avx2";
+#elif defined(ML_SIMD_AVX)
+	return "avx";
+#elif defined(ML_SIMD_SSE2)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
+
+float Random(float lo, float hi) {
+	return lo + (hi - lo) * rand() / (float)RAND_MAX;
+}
+
+MLVector3 RandomVector3() {
+	return MLVector3(Random(-10, 10), Random(-10, 10), Random(-10, 10));
+}
+
+// rotation, scale and translation, so every inverse exists
+MLMatrix4 RandomAffine() {
+	MLMatrix4 rx, ry, s;
+	Matrix_RotationX(&rx, Random(-3, 3));
+	Matrix_RotationY(&ry, Random(-3, 3));
+	Matrix_Scaling(&s, Random(0.5f, 2), Random(0.5f, 2), Random(0.5f, 2));
+	MLMatrix4 m = s * rx * ry;
+	m._41 = Random(-10, 10);
+	m._42 = Random(-10, 10);
+	m._43 = Random(-10, 10);
+	return m;
+}
+
+MLQuaternion RandomRotation() {
+	return Quat_RotationAxis(RandomVector3(), Random(-3, 3));
+}
+
+// inputs a and b of every type, outputs and streams holding the same values
+struct Data {
+	std::vector<MLVector3> v3a, v3b, v3out;
+	std::vector<MLVector4> v4a, v4b, v4out;
+	std::vector<MLMatrix4> ma, mb, mout;
+	std::vector<MLAffine3x4> aa, ab, aout;
+	std::vector<MLQuaternion> qa, qb, qout;
+	std::vector<MLPlane> planes, planeout;
+	std::vector<float> f, fout;
+	std::vector<int> iout;
+	std::vector<unsigned char> classes;
+	MLVector4Stream s4, s4out, spheres;
+	MLVector3Stream s3, s3out, boxmin, boxmax;
+	MLQuaternionStream sqa, sqb, sqout;
+	MLFrustum frustum;
+	float sink;
+};
+Data d;
+
+void Fill() {
+	int n = MAXBATCH;
+	d.v3a.resize(n); d.v3b.resize(n); d.v3out.resize(n);
+	d.v4a.resize(n); d.v4b.resize(n); d.v4out.resize(n);
+	d.ma.resize(n); d.mb.resize(n); d.mout.resize(n);
+	d.aa.resize(n); d.ab.resize(n); d.aout.resize(n);
+	d.qa.resize(n); d.qb.resize(n); d.qout.resize(n);
+	d.planes.resize(n); d.planeout.resize(n);
+	d.f.resize(n); d.fout.resize(n); d.iout.resize(n); d.classes.resize(n);
+	d.s4.Resize(n); d.spheres.Resize(n); d.s3.Resize(n); d.boxmin.Resize(n); d.boxmax.Resize(n);
+	d.sqa.Resize(n); d.sqb.Resize(n);
+	for (int i = 0; i < n; i++) {
+		d.v3a[i] = RandomVector3();
+		d.v3b[i] = RandomVector3();
+		d.v4a[i] = MLVector4(d.v3a[i].x, d.v3a[i].y, d.v3a[i].z, 1.0f);
+		d.v4b[i] = MLVector4(d.v3b[i].x, d.v3b[i].y, d.v3b[i].z, 0.0f);
+		d.ma[i] = RandomAffine();
+		d.mb[i] = RandomAffine();
+		d.aa[i] = Affine_FromMatrix(d.ma[i]);
+		d.ab[i] = Affine_FromMatrix(d.mb[i]);
+		d.qa[i] = RandomRotation();
+		d.qb[i] = RandomRotation();
+		d.planes[i] = MLPlane(Random(-1, 1), Random(-1, 1), Random(-1, 1), Random(-10, 10));
+		d.f[i] = Random(-3, 3);
+		d.s4.x[i] = d.s3.x[i] = d.v3a[i].x;
+		d.s4.y[i] = d.s3.y[i] = d.v3a[i].y;
+		d.s4.z[i] = d.s3.z[i] = d.v3a[i].z;
+		d.s4.w[i] = 1.0f;
+		d.spheres.x[i] = d.v3a[i].x * 10;
+		d.spheres.y[i] = d.v3a[i].y * 10;
+		d.spheres.z[i] = d.v3a[i].z * 10;
+		d.spheres.w[i] = Random(0.5f, 5);
+		d.boxmin.x[i] = d.spheres.x[i] - d.spheres.w[i];
+		d.boxmin.y[i] = d.spheres.y[i] - d.spheres.w[i];
+		d.boxmin.z[i] = d.spheres.z[i] - d.spheres.w[i];
+		d.boxmax.x[i] = d.spheres.x[i] + d.spheres.w[i];
+		d.boxmax.y[i] = d.spheres.y[i] + d.spheres.w[i];
+		d.boxmax.z[i] = d.spheres.z[i] + d.spheres.w[i];
+		d.sqa.x[i] = d.qa[i].x; d.sqa.y[i] = d.qa[i].y; d.sqa.z[i] = d.qa[i].z; d.sqa.w[i] = d.qa[i].w;
+		d.sqb.x[i] = d.qb[i].x; d.sqb.y[i] = d.qb[i].y; d.sqb.z[i] = d.qb[i].z; d.sqb.w[i] = d.qb[i].w;
+	}
+	MLMatrix4 view, proj;
+	MLVector3 eye(0, 20, -80), at(0, 0, 0), up(0, 1, 0);
+	Matrix_LookAt(&view, &eye, &at, &up);
+	Matrix_PerspectiveFov(&proj, 1.0f, 4.0f / 3.0f, 1.0f, 200.0f);
+	d.frustum = Frustum_FromMatrix(view * proj);
+}
+
+// streams keep their padded storage when shrunk, so the first n values stay
+void SetStreamCount(int n) {
+	MLVector3Stream *streams[] = { &d.s4, &d.spheres, &d.s3, &d.boxmin, &d.boxmax, &d.sqa, &d.sqb };
+	for (MLVector3Stream *s : streams)
+		s->Resize(n);
+}
+
+struct Result {
+	std::string name;
+	int batch;
+	double ns;
+};
+std::vector<Result> results;
+
+// op(n) runs the operation n times, on elements 0 .. n - 1
+// called through std::function so the repetitions can't be merged
+void Bench(const char *name, const std::function<void(int)> &op) {
+	typedef std::chrono::high_resolution_clock Clock;
+	for (int batch : BATCHES) {
+		SetStreamCount(batch);
+		double best = 1e30;
+		for (int t = 0; t < TRIALS; t++) {
+			long long reps = 1;
+			double seconds;
+			for (;;) {
+				Clock::time_point start = Clock::now();
+				for (long long r = 0; r < reps; r++)
+					op(batch);
+				seconds = std::chrono::duration<double>(Clock::now() - start).count();
+				if (seconds >= TRIALSECONDS)
+					break;
+				reps *= 2;
+			}
+			double ns = seconds * 1e9 / ((double)reps * batch);
+			if (ns < best)
+				best = ns;
+		}
+		Result res = { name, batch, best };
+		results.push_back(res);
+		printf("%-36s %6d %10.2f ns %10.1f Mop/s\n", name, batch, best, 1e3 / best);
+	}
+}
+
+void BenchVector() {
+	Bench("MLVector3 -v", [](int n) {
+		for (int i = 0; i < n; i++) d.v3out[i] = -d.v3a[i];
+	});
+	Bench("MLVector3 +", [](int n) {
+		for (int i = 0; i < n; i++) d.v3out[i] = d.v3a[i] + d.v3b[i];
+	});
+	Bench("MLVector3 -", [](int n) {
+		for (int i = 0; i < n; i++) d.v3out[i] = d.v3a[i] - d.v3b[i];
+	});
+	Bench("MLVector3 * float", [](int n) {
+		for (int i = 0; i < n; i++) d.v3out[i] = d.v3a[i] * d.f[i];
+	});
+	Bench("MLVector3 / float", [](int n) {
+		for (int i = 0; i < n; i++) d.v3out[i] = d.v3a[i] / d.f[i];
+	});
+	Bench("MLVector3 ==", [](int n) {
+		for (int i = 0; i < n; i++) d.iout[i] = d.v3a[i] == d.v3b[i];
+	});
+	Bench("MLVector4 * float", [](int n) {
+		for (int i = 0; i < n; i++) d.v4out[i] = d.v4a[i] * d.f[i];
+	});
+	Bench("MLVector4 / float", [](int n) {
+		for (int i = 0; i < n; i++) d.v4out[i] = d.v4a[i] / d.f[i];
+	});
+	Bench("MLVector4 *=", [](int n) {
+		for (int i = 0; i < n; i++) {
+			d.v4out[i] = d.v4a[i];
+			d.v4out[i] *= d.f[i];
+		}
+	});
+	Bench("MLVector4 /=", [](int n) {
+		for (int i = 0; i < n; i++) {
+			d.v4out[i] = d.v4a[i];
+			d.v4out[i] /= d.f[i];
+		}
+	});
+	Bench("Vec3_Length", [](int n) {
+		for (int i = 0; i < n; i++) d.fout[i] = Vec3_Length(d.v3a[i]);
+	});
+	Bench("Vec3_Normalize", [](int n) {
+		for (int i = 0; i < n; i++) d.v3out[i] = Vec3_Normalize(d.v3a[i]);
+	});
+	Bench("Vec3_Dot", [](int n) {
+		for (int i = 0; i < n; i++) d.fout[i] = Vec3_Dot(d.v3a[i], d.v3b[i]);
+	});
+	Bench("Vec4_Dot", [](int n) {
+		for (int i = 0; i < n; i++) d.fout[i] = Vec4_Dot(d.v4a[i], d.v4b[i]);
+	});
+	Bench("Vec3_Cross", [](int n) {
+		for (int i = 0; i < n; i++) d.v3out[i] = Vec3_Cross(d.v3a[i], d.v3b[i]);
+	});
+	Bench("Vec4_Transform", [](int n) {
+		for (int i = 0; i < n; i++) d.v4out[i] = Vec4_Transform(d.v4a[i], d.ma[0]);
+	});
+	Bench("Vec4_Transform per vector matrix", [](int n) {
+		for (int i = 0; i < n; i++) d.v4out[i] = Vec4_Transform(d.v4a[i], d.ma[i]);
+	});
+	Bench("Vec3_TransformCoord affine", [](int n) {
+		for (int i = 0; i < n; i++) d.v3out[i] = Vec3_TransformCoord(d.v3a[i], d.aa[0]);
+	});
+	Bench("Vec3_TransformNormal affine", [](int n) {
+		for (int i = 0; i < n; i++) d.v3out[i] = Vec3_TransformNormal(d.v3a[i], d.aa[0]);
+	});
+	Bench("Plane_DotCoord", [](int n) {
+		for (int i = 0; i < n; i++) d.fout[i] = Plane_DotCoord(d.planes[i], d.v3a[i]);
+	});
+	Bench("Plane_Normalize", [](int n) {
+		for (int i = 0; i < n; i++) d.planeout[i] = Plane_Normalize(d.planes[i]);
+	});
+}
+
+void BenchStream() {
+	// streams were resized to the batch, ns per vector, compare with the single versions
+	Bench("Vec4_TransformStream", [](int) {
+		Vec4_TransformStream(&d.s4out, &d.s4, &d.ma[0]);
+	});
+	Bench("Vec4_TransformStream affine", [](int) {
+		Vec4_TransformStream(&d.s4out, &d.s4, &d.aa[0]);
+	});
+	Bench("Vec3_TransformCoordStream", [](int) {
+		Vec3_TransformCoordStream(&d.s4out, &d.s3, &d.ma[0]);
+	});
+	Bench("Vec3_TransformNormalStream", [](int) {
+		Vec3_TransformNormalStream(&d.s3out, &d.s3, &d.ma[0]);
+	});
+	Bench("Quat_MultiplyStream", [](int) {
+		Quat_MultiplyStream(&d.sqout, &d.sqa, &d.sqb);
+	});
+	Bench("Quat_NormalizeStream", [](int) {
+		Quat_NormalizeStream(&d.sqout, &d.sqa);
+	});
+	Bench("Quat_NlerpStream", [](int) {
+		Quat_NlerpStream(&d.sqout, &d.sqa, &d.sqb, 0.3f);
+	});
+	Bench("Frustum_ClassifySphereStream", [](int) {
+		Frustum_ClassifySphereStream(&d.classes[0], &d.frustum, &d.spheres);
+	});
+	Bench("Frustum_ClassifyAABBStream", [](int) {
+		Frustum_ClassifyAABBStream(&d.classes[0], &d.frustum, &d.boxmin, &d.boxmax);
+	});
+}
+
+void BenchMatrix() {
+	Bench("MLMatrix4 *", [](int n) {
+		for (int i = 0; i < n; i++) d.mout[i] = d.ma[i] * d.mb[i];
+	});
+	Bench("MLAffine3x4 *", [](int n) {
+		for (int i = 0; i < n; i++) d.aout[i] = d.aa[i] * d.ab[i];
+	});
+	Bench("MLAffine3x4 * MLMatrix4", [](int n) {
+		for (int i = 0; i < n; i++) d.mout[i] = d.aa[i] * d.mb[i];
+	});
+	Bench("Matrix_Identity", [](int n) {
+		for (int i = 0; i < n; i++) d.mout[i] = Matrix_Identity();
+	});
+	Bench("Matrix_Translation", [](int n) {
+		for (int i = 0; i < n; i++) d.mout[i] = Matrix_Translation(d.f[i], 1.0f, 2.0f);
+	});
+	Bench("Matrix_Scaling", [](int n) {
+		for (int i = 0; i < n; i++) d.mout[i] = Matrix_Scaling(d.f[i], 1.0f, 2.0f);
+	});
+	Bench("Matrix_RotationX", [](int n) {
+		for (int i = 0; i < n; i++) Matrix_RotationX(&d.mout[i], d.f[i]);
+	});
+	Bench("Matrix_RotationY", [](int n) {
+		for (int i = 0; i < n; i++) Matrix_RotationY(&d.mout[i], d.f[i]);
+	});
+	Bench("Matrix_RotationZ", [](int n) {
+		for (int i = 0; i < n; i++) Matrix_RotationZ(&d.mout[i], d.f[i]);
+	});
+	Bench("Matrix_Transpose", [](int n) {
+		for (int i = 0; i < n; i++) d.mout[i] = Matrix_Transpose(d.ma[i]);
+	});
+	Bench("Matrix_Inverse", [](int n) {
+		for (int i = 0; i < n; i++) Matrix_Inverse(&d.mout[i], &d.ma[i]);
+	});
+	Bench("Matrix_InverseAffine", [](int n) {
+		for (int i = 0; i < n; i++) Matrix_InverseAffine(&d.mout[i], &d.ma[i]);
+	});
+	Bench("Matrix_InverseTranspose3x3", [](int n) {
+		for (int i = 0; i < n; i++) Matrix_InverseTranspose3x3(&d.mout[i], &d.ma[i]);
+	});
+	Bench("Affine_Inverse", [](int n) {
+		for (int i = 0; i < n; i++) d.aout[i] = Affine_Inverse(d.aa[i]);
+	});
+	Bench("Affine_FromMatrix", [](int n) {
+		for (int i = 0; i < n; i++) d.aout[i] = Affine_FromMatrix(d.ma[i]);
+	});
+	Bench("Matrix_FromAffine", [](int n) {
+		for (int i = 0; i < n; i++) d.mout[i] = Matrix_FromAffine(d.aa[i]);
+	});
+	Bench("Cofactor3x3", [](int n) {
+		for (int i = 0; i < n; i++) d.fout[i] = Cofactor3x3(&d.ma[i], i & 3, (i >> 2) & 3);
+	});
+	Bench("Matrix_LookAt", [](int n) {
+		MLVector3 up(0.0f, 1.0f, 0.0f);
+		for (int i = 0; i < n; i++) Matrix_LookAt(&d.mout[i], &d.v3a[i], &d.v3b[i], &up);
+	});
+	Bench("Matrix_PerspectiveFov", [](int n) {
+		for (int i = 0; i < n; i++)
+			Matrix_PerspectiveFov(&d.mout[i], 1.0f + d.f[i] * 0.1f, 4.0f / 3.0f, 1.0f, 1000.0f);
+	});
+	Bench("Matrix_Viewport", [](int n) {
+		for (int i = 0; i < n; i++) d.mout[i] = Matrix_Viewport(0.0f, 0.0f, 800 + i, 600);
+	});
+	Bench("Frustum_FromMatrix", [](int n) {
+		MLFrustum f;
+		for (int i = 0; i < n; i++) {
+			f = Frustum_FromMatrix(d.ma[i]);
+			d.planeout[i] = f.planes[i % 6];
+		}
+	});
+	Bench("Frustum_ClassifySphere", [](int n) {
+		for (int i = 0; i < n; i++)
+			d.classes[i] = (unsigned char)Frustum_ClassifySphere(d.frustum, d.v3a[i], d.f[i]);
+	});
+	Bench("Frustum_ClassifyAABB", [](int n) {
+		for (int i = 0; i < n; i++)
+			d.classes[i] = (unsigned char)Frustum_ClassifyAABB(d.frustum, d.v3a[i], d.v3b[i]);
+	});
+}
+
+void BenchQuaternion() {
+	Bench("Quat_Dot", [](int n) {
+		for (int i = 0; i < n; i++) d.fout[i] = Quat_Dot(d.qa[i], d.qb[i]);
+	});
+	Bench("Quat_Conjugate", [](int n) {
+		for (int i = 0; i < n; i++) d.qout[i] = Quat_Conjugate(d.qa[i]);
+	});
+	Bench("Quat_Normalize", [](int n) {
+		for (int i = 0; i < n; i++) d.qout[i] = Quat_Normalize(d.qa[i]);
+	});
+	Bench("MLQuaternion *", [](int n) {
+		for (int i = 0; i < n; i++) d.qout[i] = d.qa[i] * d.qb[i];
+	});
+	Bench("Quat_RotationAxis", [](int n) {
+		for (int i = 0; i < n; i++) d.qout[i] = Quat_RotationAxis(d.v3a[i], d.f[i]);
+	});
+	Bench("Quat_RotationMatrix", [](int n) {
+		for (int i = 0; i < n; i++) d.qout[i] = Quat_RotationMatrix(d.ma[i]);
+	});
+	Bench("Matrix_RotationQuaternion", [](int n) {
+		for (int i = 0; i < n; i++) d.mout[i] = Matrix_RotationQuaternion(d.qa[i]);
+	});
+	Bench("Quat_Slerp", [](int n) {
+		for (int i = 0; i < n; i++) d.qout[i] = Quat_Slerp(d.qa[i], d.qb[i], 0.3f);
+	});
+	Bench("Quat_Nlerp", [](int n) {
+		for (int i = 0; i < n; i++) d.qout[i] = Quat_Nlerp(d.qa[i], d.qb[i], 0.3f);
+	});
+	Bench("Vec3_Rotate", [](int n) {
+		for (int i = 0; i < n; i++) d.v3out[i] = Vec3_Rotate(d.v3a[i], d.qa[i]);
+	});
+}
+
+/****************************************************
+* Accuracy check
+* The kernels the build selected, AVX, SSE2 or scalar with ML_SIMD_DISABLE,
+* against the row times column Vec4_Dot code they replaced, so run it once
+* per SIMD level. A float dot product of four terms, summed in any order and
+* with or without fused multiply add, is within 2 * FLT_EPSILON * sum |a_k b_k|
+* of the exact result, so a kernel and the reference may differ by twice that.
+* Inverses are compared with a cofactor inverse in double.
+*/
+
+const double DOTTOLERANCE = 4 * FLT_EPSILON;
+// error of an inverse over its largest element, the test matrices are well conditioned
+const double INVERSETOLERANCE = 16 * FLT_EPSILON;
+// odd stream length, so the kernels' tails are checked too
+const int VERIFYCOUNT = 1003;
+const int VERIFYMATRICES = 4096;
+
+// worst error of one function in units of its tolerance
+class Check {
+public:
+	Check(const char *name) : name(name), values(0), inexact(0), worst(0) {}
+
+	void Add(float got, double ref, double tolerance) {
+		values++;
+		if (got != ref)
+			inexact++;
+		double err = fabs(got - ref);
+		double ratio = err == 0 ? 0 : tolerance > 0 ? err / tolerance : HUGE_VAL;
+		// written so a NaN fails too
+		if (!(ratio <= worst))
+			worst = ratio;
+	}
+
+	bool Report() const {
+		bool ok = worst <= 1;
+		printf("%-36s %8d values %8d inexact %10.3f of tolerance  %s\n", name, values, inexact,
+			worst, ok ? "ok" : "FAIL");
+		return ok;
+	}
+
+private:
+	const char *name;
+	int values, inexact;
+	double worst;
+};
+
+// diagonally dominant, so the inverse exists and is well conditioned
+MLMatrix4 RandomMatrix() {
+	MLMatrix4 m;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++)
+			m.m[i][j] = Random(-1, 1);
+		m.m[i][i] += Random(0, 1) < 0.5f ? -4.0f : 4.0f;
+	}
+	return m;
+}
+
+MLVector4 Row(const MLMatrix4 &m, int i) {
+	return MLVector4(m.m[i][0], m.m[i][1], m.m[i][2], m.m[i][3]);
+}
+
+MLVector4 Column(const MLMatrix4 &m, int j) {
+	return MLVector4(m.m[0][j], m.m[1][j], m.m[2][j], m.m[3][j]);
+}
+
+float AbsDot(const MLVector4 &a, const MLVector4 &b) {
+	return fabsf(a.x * b.x) + fabsf(a.y * b.y) + fabsf(a.z * b.z) + fabsf(a.w * b.w);
+}
+
+// one component of v * m against Vec4_Dot of v and column j
+void AddTransformed(Check *check, float got, const MLVector4 &v, const MLMatrix4 &m, int j) {
+	MLVector4 col = Column(m, j);
+	check->Add(got, Vec4_Dot(v, col), DOTTOLERANCE * AbsDot(v, col));
+}
+
+// 3x3 minor without row and column, signed, and the sum of the absolute values of its terms
+double CofactorReference(const MLMatrix4 &m, int row, int col, double *magnitude) {
+	double s[3][3];
+	for (int i = 0, x = 0; i < 4; i++) {
+		if (i == row)
+			continue;
+		for (int j = 0, y = 0; j < 4; j++) {
+			if (j != col)
+				s[x][y++] = m.m[i][j];
+		}
+		x++;
+	}
+	double res = s[0][0] * (s[1][1] * s[2][2] - s[1][2] * s[2][1]) -
+		s[0][1] * (s[1][0] * s[2][2] - s[1][2] * s[2][0]) +
+		s[0][2] * (s[1][0] * s[2][1] - s[1][1] * s[2][0]);
+	*magnitude = fabs(s[0][0]) * (fabs(s[1][1] * s[2][2]) + fabs(s[1][2] * s[2][1])) +
+		fabs(s[0][1]) * (fabs(s[1][0] * s[2][2]) + fabs(s[1][2] * s[2][0])) +
+		fabs(s[0][2]) * (fabs(s[1][0] * s[2][1]) + fabs(s[1][1] * s[2][0]));
+	return (row + col) & 1 ? -res : res;
+}
+
+// adjugate over determinant, returns the largest element
+double InverseReference(double out[4][4], const MLMatrix4 &m) {
+	double magnitude;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++)
+			out[j][i] = CofactorReference(m, i, j, &magnitude);
+	}
+	double det = 0;
+	for (int i = 0; i < 4; i++)
+		det += m.m[0][i] * out[i][0];
+	double largest = 0;
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			out[i][j] /= det;
+			largest = fmax(largest, fabs(out[i][j]));
+		}
+	}
+	return largest;
+}
+
+void AddInverse(Check *check, const MLMatrix4 &got, const MLMatrix4 &m) {
+	double ref[4][4];
+	double tolerance = INVERSETOLERANCE * InverseReference(ref, m);
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++)
+			check->Add(got.m[i][j], ref[i][j], tolerance);
+	}
+}
+
+bool VerifyTransform(const char *mulname, const char *transformname,
+	const std::vector<MLMatrix4> &ma, const std::vector<MLMatrix4> &mb) {
+	bool ok = true;
+	Check mul(mulname);
+	for (size_t k = 0; k < ma.size(); k++) {
+		MLMatrix4 res = ma[k] * mb[k];
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++)
+				AddTransformed(&mul, res.m[i][j], Row(ma[k], i), mb[k], j);
+		}
+	}
+	ok &= mul.Report();
+	Check transform(transformname);
+	for (size_t k = 0; k < ma.size(); k++) {
+		MLVector4 v(d.v3a[k].x, d.v3a[k].y, d.v3a[k].z, d.f[k]);
+		MLVector4 res = Vec4_Transform(v, ma[k]);
+		AddTransformed(&transform, res.x, v, ma[k], 0);
+		AddTransformed(&transform, res.y, v, ma[k], 1);
+		AddTransformed(&transform, res.z, v, ma[k], 2);
+		AddTransformed(&transform, res.w, v, ma[k], 3);
+	}
+	ok &= transform.Report();
+	return ok;
+}
+
+bool VerifyStream(const std::vector<MLMatrix4> &ma) {
+	int n = VERIFYCOUNT;
+	MLVector4Stream in4(n), out4;
+	MLVector3Stream in3(n), out3;
+	for (int i = 0; i < n; i++) {
+		in4.x[i] = in3.x[i] = d.v3a[i].x;
+		in4.y[i] = in3.y[i] = d.v3a[i].y;
+		in4.z[i] = in3.z[i] = d.v3a[i].z;
+		in4.w[i] = d.f[i];
+	}
+	Check transform("Vec4_TransformStream"), coord("Vec3_TransformCoordStream");
+	Check normal("Vec3_TransformNormalStream");
+	for (int k = 0; k < 16; k++) {
+		const MLMatrix4 &m = ma[k];
+		Vec4_TransformStream(&out4, &in4, &m);
+		for (int i = 0; i < n; i++) {
+			MLVector4 v(in4.x[i], in4.y[i], in4.z[i], in4.w[i]);
+			AddTransformed(&transform, out4.x[i], v, m, 0);
+			AddTransformed(&transform, out4.y[i], v, m, 1);
+			AddTransformed(&transform, out4.z[i], v, m, 2);
+			AddTransformed(&transform, out4.w[i], v, m, 3);
+		}
+		Vec3_TransformCoordStream(&out4, &in3, &m);
+		for (int i = 0; i < n; i++) {
+			MLVector4 v(in3.x[i], in3.y[i], in3.z[i], 1.0f);
+			AddTransformed(&coord, out4.x[i], v, m, 0);
+			AddTransformed(&coord, out4.y[i], v, m, 1);
+			AddTransformed(&coord, out4.z[i], v, m, 2);
+			AddTransformed(&coord, out4.w[i], v, m, 3);
+		}
+		Vec3_TransformNormalStream(&out3, &in3, &m);
+		for (int i = 0; i < n; i++) {
+			MLVector4 v(in3.x[i], in3.y[i], in3.z[i], 0.0f);
+			AddTransformed(&normal, out3.x[i], v, m, 0);
+			AddTransformed(&normal, out3.y[i], v, m, 1);
+			AddTransformed(&normal, out3.z[i], v, m, 2);
+		}
+	}
+	bool ok = transform.Report();
+	ok &= coord.Report();
+	ok &= normal.Report();
+	return ok;
+}
+
+bool VerifyInverse(const std::vector<MLMatrix4> &general) {
+	bool ok = true;
+	Check cofactor("Cofactor3x3");
+	for (const MLMatrix4 &m : general) {
+		for (int i = 0; i < 16; i++) {
+			double magnitude;
+			double ref = CofactorReference(m, i / 4, i % 4, &magnitude);
+			cofactor.Add(Cofactor3x3(&m, i / 4, i % 4), ref, DOTTOLERANCE * magnitude);
+		}
+	}
+	ok &= cofactor.Report();
+	Check inverse("Matrix_Inverse"), inverseaffine("Matrix_InverseAffine");
+	Check normal("Matrix_InverseTranspose3x3");
+	for (size_t k = 0; k < general.size(); k++) {
+		// in place every other time, pOut may be pM
+		MLMatrix4 res = general[k];
+		Matrix_Inverse(&res, k & 1 ? &res : &general[k]);
+		AddInverse(&inverse, res, general[k]);
+		const MLMatrix4 &m = d.ma[k];
+		Matrix_Inverse(&res, &m);
+		AddInverse(&inverse, res, m);
+		Matrix_InverseAffine(&res, &m);
+		AddInverse(&inverseaffine, res, m);
+		// transpose of the inverse's 3x3, identity elsewhere
+		double ref[4][4];
+		double tolerance = INVERSETOLERANCE * InverseReference(ref, m);
+		Matrix_InverseTranspose3x3(&res, &m);
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 4; j++) {
+				double r = i < 3 && j < 3 ? ref[j][i] : i == j;
+				normal.Add(res.m[i][j], r, tolerance);
+			}
+		}
+	}
+	ok &= inverse.Report();
+	ok &= inverseaffine.Report();
+	ok &= normal.Report();
+	return ok;
+}
+
+bool Verify() {
+	std::vector<MLMatrix4> general(VERIFYMATRICES), general2(VERIFYMATRICES);
+	for (int i = 0; i < VERIFYMATRICES; i++) {
+		general[i] = RandomMatrix();
+		general2[i] = RandomMatrix();
+	}
+	bool ok = VerifyTransform("MLMatrix4 *", "Vec4_Transform", general, general2);
+	ok &= VerifyTransform("MLMatrix4 * affine", "Vec4_Transform affine",
+		std::vector<MLMatrix4>(d.ma.begin(), d.ma.begin() + VERIFYMATRICES),
+		std::vector<MLMatrix4>(d.mb.begin(), d.mb.begin() + VERIFYMATRICES));
+	ok &= VerifyStream(general);
+	ok &= VerifyInverse(general);
+	printf(ok ? "all ok\n" : "MISMATCH\n");
+	return ok;
+}
+
+bool WriteCsv(const char *filename) {
+	FILE *fp = fopen(filename, "w");
+	if (!fp)
+		return false;
+	fprintf(fp, "name,batch,simd,ns_per_op,mops_per_s\n");
+	for (const Result &res : results)
+		fprintf(fp, "\"%s\",%d,%s,%.3f,%.3f\n", res.name.c_str(), res.batch, SimdName(), res.ns,
+			1e3 / res.ns);
+	fclose(fp);
+	return true;
+}
+
+}
+
+int main(int argc, char **argv) {
+	bool verify = argc > 1 && strcmp(argv[1], "-verify") == 0;
+	printf("ML math %s, %s\n", verify ? "accuracy check" : "benchmark", SimdName());
+	Fill();
+	if (verify)
+		return Verify() ? 0 : 1;
+	BenchVector();
+	BenchStream();
+	BenchMatrix();
+	BenchQuaternion();
+	if (argc > 1 && !WriteCsv(argv[1])) {
+		fprintf(stderr, "can't write %s\n", argv[1]);
+		return 1;
+	}
+	return 0;
+}